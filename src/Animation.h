@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <future>
+#include <utility>
+#include <vector>
+
+#include "Camera.h"
+#include "Scene.h"
+#include "util/Vec.h"
+
+// Values at points in time, interpolated linearly in between and held before the first and after the last
+template <std::floating_point T, typename Value>
+class Keyframes {
+private:
+    std::vector<std::pair<T, Value>> m_keys;
+
+public:
+    Keyframes()
+        : m_keys({}) {};
+
+    bool empty() const { return m_keys.empty(); }
+
+    void add(T time, Value const& value)
+    {
+        auto const position = std::upper_bound(m_keys.begin(), m_keys.end(), time, [](T time, auto const& key) { return time < key.first; });
+
+        m_keys.insert(position, { time, value });
+    }
+
+    Value at(T time) const
+    {
+        auto const next = std::upper_bound(m_keys.begin(), m_keys.end(), time, [](T time, auto const& key) { return time < key.first; });
+
+        if (next == m_keys.begin())
+            return next->second;
+
+        if (next == m_keys.end())
+            return m_keys.back().second;
+
+        auto const& [t0, v0] = *(next - 1);
+        auto const& [t1, v1] = *next;
+
+        return v0 + ((time - t0) / (t1 - t0)) * (v1 - v0);
+    }
+};
+
+/**
+ * Keyframed motion of the shapes, lights and camera of a scene, and rendering it frame by frame
+ *
+ * Shapes are moved by an offset from where they were added to the scene, lights and the camera are placed
+ * where their keyframes say. Posing a frame translates the shapes that moved and refits the scene instead of
+ * building it again, so the BVH keeps the hierarchy it was built with.
+ *
+ * render() overlaps the frames with their output: while output() runs on a thread of its own for one frame,
+ * the next one is posed and rendered.
+ */
+template <std::floating_point T>
+class BasicAnimation {
+private:
+    using Scene = BasicScene<T>;
+    using Camera = BasicCamera<T>;
+
+    struct ShapeTrack {
+        uint32_t m_shape;
+        Keyframes<T, Vec3<T>> m_offset;
+        Vec3<T> m_applied; // Offset the shape was last moved to
+    };
+
+    struct LightTrack {
+        uint32_t m_light;
+        Keyframes<T, Vec3<T>> m_position;
+    };
+
+    std::vector<ShapeTrack> m_shapes;
+    std::vector<LightTrack> m_lights;
+
+    Keyframes<T, Vec3<T>> m_eye;
+    Keyframes<T, Vec3<T>> m_look_at;
+    Keyframes<T, Vec3<T>> m_up;
+
+public:
+    BasicAnimation()
+        : m_shapes({})
+        , m_lights({})
+        , m_eye({})
+        , m_look_at({})
+        , m_up({}) {};
+
+    // Offset of a shape, by its index in the scene, from where it was added
+    void move_shape(uint32_t shape, T time, Vec3<T> const& offset)
+    {
+        auto track = std::find_if(m_shapes.begin(), m_shapes.end(), [&](auto const& track) { return track.m_shape == shape; });
+
+        if (track == m_shapes.end()) {
+            m_shapes.push_back({ shape, {}, Vec3<T> { 0 } });
+            track = m_shapes.end() - 1;
+        }
+
+        track->m_offset.add(time, offset);
+    }
+
+    void move_light(uint32_t light, T time, Vec3<T> const& position)
+    {
+        auto track = std::find_if(m_lights.begin(), m_lights.end(), [&](auto const& track) { return track.m_light == light; });
+
+        if (track == m_lights.end()) {
+            m_lights.push_back({ light, {} });
+            track = m_lights.end() - 1;
+        }
+
+        track->m_position.add(time, position);
+    }
+
+    void move_camera(T time, Vec3<T> const& eye, Vec3<T> const& look_at, Vec3<T> const& up)
+    {
+        m_eye.add(time, eye);
+        m_look_at.add(time, look_at);
+        m_up.add(time, up);
+    }
+
+    // Poses the scene and the camera at a point in time; the scene must have been built.
+    void apply(Scene& scene, Camera& camera, T time)
+    {
+        auto moved = false;
+
+        for (auto&& track : m_shapes) {
+            auto const offset = track.m_offset.at(time);
+            auto const delta = offset - track.m_applied;
+
+            if (delta.x == 0 && delta.y == 0 && delta.z == 0)
+                continue;
+
+            scene.get_shapes()[track.m_shape]->translate(delta);
+            track.m_applied = offset;
+            moved = true;
+        }
+
+        if (moved)
+            scene.refit();
+
+        for (auto&& track : m_lights)
+            scene.get_lights()[track.m_light]->m_position = track.m_position.at(time);
+
+        if (!m_lights.empty())
+            scene.update_lights();
+
+        if (!m_eye.empty())
+            camera.set_view(m_eye.at(time), m_look_at.at(time), m_up.at(time));
+    }
+
+    /**
+     * Renders frames [first, first + count) of frame_time each, calling output(frame, pixels) for every
+     * one of them in order. Returns false if any output() did.
+     */
+    bool render(Scene& scene, Camera& camera, std::size_t first, std::size_t count, T frame_time, auto output)
+    {
+        auto pending = std::future<bool> {};
+        auto ok = true;
+
+        for (auto frame = first; frame < first + count; frame++) {
+            apply(scene, camera, frame * frame_time);
+
+            camera.render(scene);
+
+            auto pixels = camera.take_pixels();
+
+            // The previous frame has to be out before handing over this one, which keeps at most one waiting
+            if (pending.valid())
+                ok &= pending.get();
+
+            pending = std::async(std::launch::async, [&output, frame, pixels = std::move(pixels)] { return output(frame, pixels); });
+        }
+
+        if (pending.valid())
+            ok &= pending.get();
+
+        return ok;
+    }
+};
+
+using Animation = BasicAnimation<double>;
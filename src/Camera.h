@@ -1,184 +1,748 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
-#include <mutex>
+#include <bit>
+#include <chrono>
+#include <concepts>
+#include <span>
+#include <stop_token>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include "Scene.h"
+#include "Wavefront.h"
 #include "util/Config.h"
 #include "util/Ray.h"
+#include "util/RayPacket.h"
 #include "util/Record.h"
+#include "util/Sampling.h"
+#include "util/Stats.h"
+#include "util/Tiling.h"
+#include "util/ToneMapping.h"
 #include "util/Vec.h"
 
-class Camera {
+template <std::floating_point T>
+class BasicCamera {
 private:
-    Vec3<double> m_eye;
-    Vec3<double> m_look_at;
-    Vec3<double> m_up;
+    using Ray = BasicRay<T>;
+    using RayPacket = BasicRayPacket<T>;
+    using Scene = BasicScene<T>;
+    using Hit = BasicHit<T>;
+    using PacketHit = BasicPacketHit<T>;
+    using PacketMask = PacketMaskOf<T>;
 
-    double m_fov_y;
-    double m_focal_distance;
+    Vec3<T> m_eye;
+    Vec3<T> m_look_at;
+    Vec3<T> m_up;
+
+    T m_fov_y;
+    T m_focal_distance;
 
     uint32_t m_viewport_width;
     uint32_t m_viewport_height;
 
-    Vec3<double> m_u;
-    Vec3<double> m_v;
-    Vec3<double> m_w;
+    Vec3<T> m_u;
+    Vec3<T> m_v;
+    Vec3<T> m_w;
+
+    Vec3<T> m_focal_plane_origin;
+    Vec3<T> m_focal_plane_center;
+    T m_focal_plane_height;
+    T m_focal_plane_width;
+    T m_pixel_width;
+
+    Sampling m_sampling;
+    Pipeline m_pipeline;
+    ToneMapping m_tone_mapping;
+    Tiling m_tiling;
 
-    Vec3<double> m_focal_plane_origin;
-    Vec3<double> m_focal_plane_center;
-    double m_focal_plane_height;
-    double m_focal_plane_width;
-    double m_pixel_width;
+    // Linear colors of the last render, top row first like the image, or the sum of the accumulate() passes
+    // since; quantized into m_pixels only once a pass is done
+    std::vector<Vec3<float>> m_radiance;
+    std::size_t m_accumulated;
 
     std::vector<Vec3<uint8_t>> m_pixels;
-    std::vector<std::thread> m_workers;
 
-    std::mutex m_mutex;
+#ifdef RAYTRACER_ENABLE_STATS
+    // Written by the workers like the viewport, each to its own pixels, tiles and slot
+    mutable Raytracer::Stats::Frame m_stats;
+
+    // Charges the work counted on this thread since the last charge, plus shared, to the pixels (i, j) up to
+    // (i, j + rows - 1) in equal parts
+    void charge(std::size_t i, std::size_t j, std::size_t rows = 1, uint64_t shared = 0) const
+    {
+        auto const work = Raytracer::Stats::take_work() / rows + shared;
+
+        for (auto row = 0uz; row < rows; row++)
+            m_stats.m_cost[(m_viewport_height - (j + row + 1)) * m_viewport_width + i] = work;
+    }
+#endif
 
 public:
-    Camera(auto eye, auto look_at, auto up, auto fov_y, auto focal_distance, auto width, auto height)
+    BasicCamera(auto eye, auto look_at, auto up, auto fov_y, auto focal_distance, auto width, auto height)
         : m_eye(eye)
         , m_look_at(look_at)
         , m_up(up)
         , m_focal_distance(focal_distance)
         , m_viewport_width(width)
         , m_viewport_height(height)
+#ifdef ENABLE_SSAA
+        , m_sampling({ .m_mode = SamplingMode::Grid })
+#else
+        , m_sampling({ .m_mode = SamplingMode::Center })
+#endif
+#ifdef ENABLE_WAVEFRONT
+        , m_pipeline(Pipeline::SortedWavefront)
+#else
+        , m_pipeline(Pipeline::Recursive)
+#endif
+        , m_tone_mapping({})
+        , m_tiling({})
+        , m_radiance(m_viewport_width * m_viewport_height, Vec3<float> { 0 })
+        , m_accumulated(0)
         , m_pixels(m_viewport_width * m_viewport_height, Vec3<uint8_t> { 0 })
-        , m_mutex {}
     {
-        m_w = normalize(look_at - eye);
-        m_u = normalize(cross(m_w, up));
-        m_v = cross(m_u, m_w);
-
         m_focal_plane_height = 2 * focal_distance * tan(fov_y / 360. * M_PI);
         m_pixel_width = m_focal_plane_height / height;
         m_focal_plane_width = m_pixel_width * width;
 
-        m_focal_plane_center = eye + focal_distance * normalize(look_at - eye);
-        m_focal_plane_origin = m_focal_plane_center - (((m_focal_plane_width / 2.) * m_u) + ((m_focal_plane_height / 2.) * m_v));
+        set_view(m_eye, m_look_at, m_up);
     }
 
-    friend __attribute__((flatten)) auto render_chunk(
-        Camera const& camera,
-        Scene const& scene,
-        std::size_t u,
-        std::size_t v)
+    // Moves the camera, keeping its field of view and resolution
+    void set_view(Vec3<T> const& eye, Vec3<T> const& look_at, Vec3<T> const& up)
     {
-        // Chunks are 64 x 64 pixels, so total area of 4096 pixels.
-        auto colors = std::vector<Vec3<double>>(4096uz);
-        auto i0 = u << 6;
-        auto j0 = v << 6;
+        m_eye = eye;
+        m_look_at = look_at;
+        m_up = up;
+        m_accumulated = 0;
 
-        for (auto i = i0; i < i0 + 64; i++)
-            for (auto j = j0; j < j0 + 64; j++) {
-#ifdef ENABLE_SSAA
-                auto get_look_at = [&](double a, double b) {
-                    return m_focal_plane_origin + (a + i) * m_pixel_width * m_u + (b + j) * m_pixel_width * m_v;
-                };
-                auto look_at = Vec3 { 0. };
-                auto get_direction = [&]() { return normalize(look_at - m_eye); };
+        m_w = normalize(m_look_at - m_eye);
+        m_u = normalize(cross(m_w, m_up));
+        m_v = cross(m_u, m_w);
 
-                auto color = scene.compute_ray_color({ look_at = get_look_at(.25, .25), get_direction() }, 0., std::numeric_limits<double>::infinity(), 0)
-                             + scene.compute_ray_color({ look_at = get_look_at(.25, .75), get_direction() }, 0., std::numeric_limits<double>::infinity(), 0)
-                             + scene.compute_ray_color({ look_at = get_look_at(.75, .25), get_direction() }, 0., std::numeric_limits<double>::infinity(), 0)
-                             + scene.compute_ray_color({ look_at = get_look_at(.75, .75), get_direction() }, 0., std::numeric_limits<double>::infinity(), 0);
+        m_focal_plane_center = m_eye + m_focal_distance * normalize(m_look_at - m_eye);
+        m_focal_plane_origin = m_focal_plane_center - (((m_focal_plane_width / 2) * m_u) + ((m_focal_plane_height / 2) * m_v));
+    }
 
-                color /= 4.;
-#else
-                auto look_at = camera.m_focal_plane_origin + (.5 + i) * camera.m_pixel_width * camera.m_u + (.5 + j) * camera.m_pixel_width * camera.m_v;
-                auto direction = normalize(look_at - camera.m_eye);
-                auto color = scene.compute_ray_color({ look_at, direction }, 0., std::numeric_limits<double>::infinity(), 0);
+    auto const& get_eye() const { return m_eye; }
+    auto const& get_look_at() const { return m_look_at; }
+    auto const& get_up() const { return m_up; }
+
+    void set_sampling(Sampling const& sampling)
+    {
+        m_sampling = sampling;
+        m_accumulated = 0;
+    }
+
+    auto const& get_sampling() const { return m_sampling; }
+
+    // Applied by resolve(); changing it does not need the scene to be traced again.
+    void set_tone_mapping(ToneMapping const& tone_mapping) { m_tone_mapping = tone_mapping; }
+    auto const& get_tone_mapping() const { return m_tone_mapping; }
+
+    // Adaptive sampling decides where to sample from the colors it gets, so it always renders recursively.
+    void set_pipeline(Pipeline pipeline) { m_pipeline = pipeline; }
+    auto get_pipeline() const { return m_pipeline; }
+
+    // Size and order of the chunks render() splits the viewport into; the image does not depend on either.
+    void set_tiling(Tiling const& tiling)
+    {
+        m_tiling = tiling;
+        m_tiling.m_size = std::max(m_tiling.m_size, 1uz);
+    }
+
+    auto const& get_tiling() const { return m_tiling; }
+
+    auto get_width() const { return m_viewport_width; }
+    auto get_height() const { return m_viewport_height; }
+
+    // The chunks render() splits the viewport into, in the order of the tiling, as (u, v) with pixel
+    // (size * u, size * v) at their lower left corner
+    std::vector<std::pair<size_t, size_t>> get_chunks() const
+    {
+        auto const size = m_tiling.m_size;
+
+        return Raytracer::Tiles::order((m_viewport_width + size - 1) / size, (m_viewport_height + size - 1) / size, m_tiling.m_order);
+    }
+
+    struct ChunkBounds {
+        std::size_t m_i0;
+        std::size_t m_i1;
+        std::size_t m_j0;
+        std::size_t m_j1;
+    };
+
+    // Pixels [i0, i1) x [j0, j1) of the chunk (u, v); chunks on the right and top edges are clipped to the viewport.
+    ChunkBounds get_chunk_bounds(std::size_t u, std::size_t v) const
+    {
+        auto const i0 = u * m_tiling.m_size;
+        auto const j0 = v * m_tiling.m_size;
+
+        return {
+            i0,
+            std::min<std::size_t>(i0 + m_tiling.m_size, m_viewport_width),
+            j0,
+            std::min<std::size_t>(j0 + m_tiling.m_size, m_viewport_height),
+        };
+    }
+
+    /**
+     * Renders the chunk (u, v) alone, returning its pixels row by row, top row first, like the image
+     *
+     * Chunks on the right and top edges are clipped to the viewport, see get_chunk_bounds(). Stitching the
+     * chunks of get_chunks() together gives the image render() does.
+     */
+    std::vector<Vec3<uint8_t>> render_tile(Scene const& scene, std::size_t u, std::size_t v)
+    {
+        auto const [i0, i1, j0, j1] = get_chunk_bounds(u, v);
+        auto const width = i1 - i0;
+        auto const height = j1 - j0;
+
+#ifdef RAYTRACER_ENABLE_STATS
+        if (m_stats.m_cost.size() != m_radiance.size())
+            m_stats.m_cost.assign(m_radiance.size(), 0);
 #endif
-                auto idx = (j - j0) + ((i - i0) << 6);
-                colors[idx] = color;
+
+        render_chunk(*this, scene, m_radiance, u, v, {});
+        m_accumulated = 0;
+
+        auto tile = std::vector<Vec3<uint8_t>>(width * height);
+
+        for (auto row = 0uz; row < height; row++) {
+            auto const first = (m_viewport_height - (j0 + height - row)) * m_viewport_width + i0;
+
+            Raytracer::ToneMap::apply(
+                std::span(m_radiance).subspan(first, width),
+                1.f,
+                m_tone_mapping,
+                std::span(tile).subspan(row * width, width));
+        }
+
+        return tile;
+    }
+
+#ifdef RAYTRACER_ENABLE_STATS
+    // Counters, tile timings and per pixel cost of the last render()
+    auto const& get_stats() const { return m_stats; }
+#endif
+
+    // Writes (or adds) a linear color into the radiance buffer; the image is stored top row first.
+    void store(std::vector<Vec3<float>>& viewport, std::size_t i, std::size_t j, Vec3<T> const& color, bool add = false) const
+    {
+        auto& pixel = viewport[(m_viewport_height - (j + 1)) * m_viewport_width + i];
+
+        if (add)
+            pixel += Vec3<float>(color);
+        else
+            pixel = Vec3<float>(color);
+    }
+
+    Ray get_primary_ray(T x, T y) const
+    {
+        // (x, y) are in pixels from the bottom left corner of the focal plane
+        RAYTRACER_STATS(Raytracer::Stats::count(Raytracer::Stats::PrimaryRays));
+
+        auto look_at = m_focal_plane_origin + x * m_pixel_width * m_u + y * m_pixel_width * m_v;
+
+        return Ray(look_at, normalize(look_at - m_eye));
+    }
+
+    // What a render_pass() traces into the radiance buffer
+    struct Pass {
+        // Squares of block x block pixels with one ray each if block > 1, see render_blocks()
+        std::size_t m_block = 1;
+        bool m_refine = false;
+
+        // One ray through (i + m_x, j + m_y) of every pixel (i, j), added to the radiance if m_add, see
+        // accumulate()
+        bool m_accumulate = false;
+        bool m_add = false;
+        T m_x = .5;
+        T m_y = .5;
+    };
+
+    // One ray per pixel through (i + x, j + y), by default its center
+    void render_center(Scene const& scene, std::vector<Vec3<float>>& viewport, std::size_t i0, std::size_t i1, std::size_t j0, std::size_t j1, T x = .5, T y = .5, bool add = false) const
+    {
+        for (auto i = i0; i < i1; i++) {
+#ifdef DISABLE_RAY_PACKETS
+            for (auto j = j0; j < j1; j++) {
+                store(viewport, i, j, scene.compute_ray_color(get_primary_ray(x + i, y + j), 0, std::numeric_limits<T>::infinity(), 0), add);
+                RAYTRACER_STATS(charge(i, j));
+            }
+#else
+            // Primary rays of neighbouring pixels in a column are traced together as one packet
+            for (auto j = j0; j < j1; j += Raytracer::Packet::width<T>) {
+                auto const lanes = std::min(Raytracer::Packet::width<T>, j1 - j);
+
+                auto packet = RayPacket {};
+                auto active = PacketMask {};
+
+                for (auto lane = 0uz; lane < lanes; lane++) {
+                    packet.set_ray(lane, get_primary_ray(x + i, y + j + lane));
+                    active[lane] = -1;
+                }
+
+                auto colors = scene.compute_ray_color(packet, active);
+
+                for (auto lane = 0uz; lane < lanes; lane++)
+                    store(viewport, i, j + lane, colors[lane], add);
+
+                RAYTRACER_STATS(charge(i, j, lanes));
             }
+#endif
+        }
+    }
+
+    void render_grid(Scene const& scene, std::vector<Vec3<float>>& viewport, std::size_t i0, std::size_t i1, std::size_t j0, std::size_t j1) const
+    {
+        auto const n = m_sampling.m_grid_size;
 
-        return colors;
+        for (auto i = i0; i < i1; i++)
+            for (auto j = j0; j < j1; j++) {
+                auto color = Vec3<T> { 0 };
+
+                for (auto a = 0uz; a < n; a++)
+                    for (auto b = 0uz; b < n; b++)
+                        color += scene.compute_ray_color(get_primary_ray(i + (a + .5) / n, j + (b + .5) / n), 0, std::numeric_limits<T>::infinity(), 0);
+
+                store(viewport, i, j, color / static_cast<T>(n * n));
+                RAYTRACER_STATS(charge(i, j));
+            }
     }
 
-    static void render_worker(
-        Camera const& camera,
-        Scene const& scene,
-        std::mutex& mutex,
-        std::vector<Vec3<uint8_t>>& viewport,
-        std::vector<std::pair<size_t, size_t>>& chunks,
-        std::atomic_uint32_t& finished_workers)
+    // Center and grid sampling with all rays of the chunk traced breadth first, see Wavefront.h
+    void render_wavefront(Scene const& scene, std::vector<Vec3<float>>& viewport, std::size_t i0, std::size_t i1, std::size_t j0, std::size_t j1) const
     {
-        auto lock = std::unique_lock<std::mutex>(mutex, std::defer_lock);
+        auto const n = m_sampling.m_mode == SamplingMode::Grid ? m_sampling.m_grid_size : 1uz;
 
-        auto pixels = std::vector<Vec3<double>> {};
-        auto rendered_chunks = std::vector<std::pair<size_t, size_t>> {};
+        thread_local auto wavefront = BasicWavefront<T> {};
+        thread_local auto rays = std::vector<Ray> {};
+        thread_local auto colors = std::vector<Vec3<T>> {};
 
-        while (true) {
-            lock.lock();
+        rays.clear();
 
-            if (!chunks.size()) {
-                lock.unlock();
-                break;
+        // Same rays in the same order as render_center() and render_grid()
+        for (auto i = i0; i < i1; i++)
+            for (auto j = j0; j < j1; j++) {
+                if (n == 1) {
+                    rays.push_back(get_primary_ray(.5 + i, .5 + j));
+                    continue;
+                }
+
+                for (auto a = 0uz; a < n; a++)
+                    for (auto b = 0uz; b < n; b++)
+                        rays.push_back(get_primary_ray(i + (a + .5) / n, j + (b + .5) / n));
             }
 
-            auto chunk = chunks.back();
-            chunks.pop_back();
+        colors.resize(rays.size());
+
+        wavefront.set_sorting(m_pipeline == Pipeline::SortedWavefront);
+        wavefront.trace(scene, rays, colors);
+
+        // The chunk is traced as a whole; its cost is shared evenly by its pixels
+        RAYTRACER_STATS(auto const work = Raytracer::Stats::take_work() / ((i1 - i0) * (j1 - j0)));
+
+        auto const* color = colors.data();
 
-            lock.unlock();
-            rendered_chunks.push_back(chunk);
+        for (auto i = i0; i < i1; i++)
+            for (auto j = j0; j < j1; j++) {
+                if (n == 1) {
+                    store(viewport, i, j, *color++);
+                } else {
+                    auto sum = Vec3<T> { 0 };
 
-            auto render = render_chunk(camera, scene, chunk.first, chunk.second);
-            pixels.insert(pixels.end(), render.begin(), render.end());
+                    for (auto sample = 0uz; sample < n * n; sample++)
+                        sum += *color++;
+
+                    store(viewport, i, j, sum / static_cast<T>(n * n));
+                }
+
+                RAYTRACER_STATS(charge(i, j, 1, work));
+            }
+    }
+
+    struct Sample {
+        Vec3<T> m_color;
+        uint32_t m_shape;
+    };
+
+    Sample trace_sample(Scene const& scene, T x, T y) const
+    {
+        auto hit = Hit {};
+        auto color = scene.compute_ray_color(get_primary_ray(x, y), 0, std::numeric_limits<T>::infinity(), 0, hit);
+
+        return { color, hit.m_shape };
+    }
+
+    // Corners are ordered bottom left, bottom right, top left, top right.
+    Vec3<T> refine(Scene const& scene, T x, T y, T size, Sample const (&corners)[4], std::size_t depth) const
+    {
+        auto subdivide = depth < m_sampling.m_max_depth;
+
+        if (subdivide) {
+            auto low = corners[0].m_color;
+            auto high = corners[0].m_color;
+            auto same_shape = true;
+
+            for (auto&& corner : corners) {
+                low.for_each([&](auto& a, auto idx) { a = std::min(a, corner.m_color[idx]); });
+                high.for_each([&](auto& a, auto idx) { a = std::max(a, corner.m_color[idx]); });
+                same_shape &= corner.m_shape == corners[0].m_shape;
+            }
+
+            auto contrast = T { 0 };
+            (high - low).for_each_const([&](auto const& a, auto) { contrast = std::max(contrast, a); });
+
+            subdivide = !same_shape || contrast > m_sampling.m_threshold;
         }
 
-        for (auto chunk_idx = 0uz; chunk_idx < rendered_chunks.size(); chunk_idx++) {
-            auto u = rendered_chunks[chunk_idx].first;
-            auto v = rendered_chunks[chunk_idx].second;
+        if (!subdivide)
+            return (corners[0].m_color + corners[1].m_color + corners[2].m_color + corners[3].m_color) / T { 4 };
+
+        auto const half = size / 2;
+
+        auto const center = trace_sample(scene, x + half, y + half);
+        auto const bottom = trace_sample(scene, x + half, y);
+        auto const left = trace_sample(scene, x, y + half);
+        auto const right = trace_sample(scene, x + size, y + half);
+        auto const top = trace_sample(scene, x + half, y + size);
+
+        Sample const quadrants[4][4] = {
+            { corners[0], bottom, left, center },
+            { bottom, corners[1], center, right },
+            { left, center, corners[2], top },
+            { center, right, top, corners[3] },
+        };
+
+        return (refine(scene, x, y, half, quadrants[0], depth + 1)
+                   + refine(scene, x + half, y, half, quadrants[1], depth + 1)
+                   + refine(scene, x, y + half, half, quadrants[2], depth + 1)
+                   + refine(scene, x + half, y + half, half, quadrants[3], depth + 1))
+               / T { 4 };
+    }
+
+    void render_adaptive(Scene const& scene, std::vector<Vec3<float>>& viewport, std::size_t i0, std::size_t i1, std::size_t j0, std::size_t j1) const
+    {
+        // Samples at every pixel corner of the chunk; each is shared by up to four pixels
+        auto const columns = i1 - i0 + 1;
+        auto const rows = j1 - j0 + 1;
 
-            auto i0 = u << 6;
-            auto j0 = v << 6;
+        thread_local auto corners = std::vector<Sample> {};
+        corners.resize(columns * rows);
+
+        for (auto i = 0uz; i < columns; i++) {
+#ifdef DISABLE_RAY_PACKETS
+            for (auto j = 0uz; j < rows; j++)
+                corners[i * rows + j] = trace_sample(scene, i0 + i, j0 + j);
+#else
+            for (auto j = 0uz; j < rows; j += Raytracer::Packet::width<T>) {
+                auto const lanes = std::min(Raytracer::Packet::width<T>, rows - j);
 
-            lock.lock();
-            for (auto i = i0; i < i0 + 64; i++)
-                for (auto j = j0; j < j0 + 64; j++) {
-                    auto const viewport_idx = (camera.m_viewport_height - (j + 1)) * camera.m_viewport_width + i;
-                    auto const pixel_idx = (chunk_idx << 12) + (j - j0) + ((i - i0) << 6);
-                    auto&& color = pixels[pixel_idx];
+                auto packet = RayPacket {};
+                auto active = PacketMask {};
+                auto hit = PacketHit {};
 
-                    color.for_each_const([&](auto const& a, auto idx) {
-                        viewport[viewport_idx][idx] = static_cast<uint8_t>(std::min(255., 255. * a));
-                    });
+                for (auto lane = 0uz; lane < lanes; lane++) {
+                    packet.set_ray(lane, get_primary_ray(i0 + i, j0 + j + lane));
+                    active[lane] = -1;
                 }
-            lock.unlock();
+
+                auto colors = scene.compute_ray_color(packet, active, hit);
+
+                for (auto lane = 0uz; lane < lanes; lane++)
+                    corners[i * rows + j + lane] = { colors[lane], static_cast<uint32_t>(hit.m_shape[lane]) };
+            }
+#endif
+        }
+
+        // Corner samples are shared, their cost is spread over the whole chunk
+        RAYTRACER_STATS(auto const corner_work = Raytracer::Stats::take_work() / ((i1 - i0) * (j1 - j0)));
+
+        for (auto i = i0; i < i1; i++)
+            for (auto j = j0; j < j1; j++) {
+                auto const corner = (i - i0) * rows + (j - j0);
+
+                Sample const pixel_corners[4] = {
+                    corners[corner],
+                    corners[corner + rows],
+                    corners[corner + 1],
+                    corners[corner + rows + 1],
+                };
+
+                store(viewport, i, j, refine(scene, i, j, T { 1 }, pixel_corners, 0));
+                RAYTRACER_STATS(charge(i, j, 1, corner_work));
+            }
+    }
+
+    /**
+     * Renders the chunk (u, v) straight into the viewport
+     *
+     * Chunks cover disjoint pixels, so workers write without synchronization. Chunks on the right and top
+     * edges are clipped to the viewport for resolutions that are not a multiple of the tile size.
+     */
+    friend __attribute__((flatten)) void render_chunk(
+        BasicCamera const& camera,
+        Scene const& scene,
+        std::vector<Vec3<float>>& viewport,
+        std::size_t u,
+        std::size_t v,
+        Pass const& pass)
+    {
+        auto const [i0, i1, j0, j1] = camera.get_chunk_bounds(u, v);
+
+        if (pass.m_accumulate) {
+            camera.render_center(scene, viewport, i0, i1, j0, j1, pass.m_x, pass.m_y, pass.m_add);
+            return;
         }
 
-        finished_workers++;
+        if (camera.m_pipeline != Pipeline::Recursive && camera.m_sampling.m_mode != SamplingMode::Adaptive) {
+            camera.render_wavefront(scene, viewport, i0, i1, j0, j1);
+            return;
+        }
+
+        switch (camera.m_sampling.m_mode) {
+        case SamplingMode::Center:
+            camera.render_center(scene, viewport, i0, i1, j0, j1);
+            break;
+        case SamplingMode::Grid:
+            camera.render_grid(scene, viewport, i0, i1, j0, j1);
+            break;
+        case SamplingMode::Adaptive:
+            camera.render_adaptive(scene, viewport, i0, i1, j0, j1);
+            break;
+        }
     }
 
-    __attribute__((flatten)) auto render(Scene const& scene)
+    /**
+     * A preview of the chunk (u, v): one ray through the lower left pixel of every block x block square from
+     * the lower left of the chunk, filling the square with its color
+     *
+     * When refining, the squares of the previous pass (of twice the size) have their lower left pixel traced
+     * already, so only the other three quarters of them are.
+     */
+    void render_blocks(Scene const& scene, std::vector<Vec3<float>>& viewport, std::size_t u, std::size_t v, std::size_t block, bool refine) const
     {
-        auto chunks = std::vector<std::pair<size_t, size_t>> {};
-        auto finished_workers = std::atomic_uint32_t {};
+        auto const [i0, i1, j0, j1] = get_chunk_bounds(u, v);
 
-        for (auto u = 0uz; u < (m_viewport_width >> 6); u++)
-            for (auto v = 0uz; v < (m_viewport_height >> 6); v++)
-                chunks.push_back(std::make_pair(u, v));
+        for (auto i = i0; i < i1; i += block)
+            for (auto j = j0; j < j1; j += block) {
+                if (!refine || (i - i0) % (2 * block) || (j - j0) % (2 * block))
+                    store(viewport, i, j, scene.compute_ray_color(get_primary_ray(.5 + i, .5 + j), 0, std::numeric_limits<T>::infinity(), 0));
 
-        for (auto i = 0uz; i < MULTITHREAD_WORKERS; i++) {
-            auto thread = std::thread(
-                render_worker,
-                std::ref(*this),
-                std::ref(scene),
-                std::ref(m_mutex),
-                std::ref(m_pixels),
-                std::ref(chunks),
-                std::ref(finished_workers));
+                auto const color = viewport[(m_viewport_height - (j + 1)) * m_viewport_width + i];
 
-            thread.detach();
+                for (auto y = j; y < std::min(j + block, j1); y++)
+                    std::fill_n(viewport.begin() + (m_viewport_height - (y + 1)) * m_viewport_width + i, std::min(block, i1 - i), color);
+            }
+    }
 
-            m_workers.push_back(std::move(thread));
+    static void render_worker(
+        BasicCamera const& camera,
+        Scene const& scene,
+        std::vector<Vec3<float>>& viewport,
+        std::vector<std::pair<size_t, size_t>> const& chunks,
+        std::atomic_size_t& next_chunk,
+        [[maybe_unused]] std::size_t worker,
+        std::stop_token const& stop,
+        Pass const& pass)
+    {
+        RAYTRACER_STATS(Raytracer::Stats::local() = {}; Raytracer::Stats::take_work());
+
+        // Workers claim chunks one at a time so expensive chunks (e.g. ones covering a torus) do not hold
+        // up a fixed share of the frame.
+        while (!stop.stop_requested()) {
+            auto const chunk_idx = next_chunk.fetch_add(1, std::memory_order_relaxed);
+
+            if (chunk_idx >= chunks.size())
+                break;
+
+            RAYTRACER_STATS(auto const start = std::chrono::steady_clock::now(); auto const before = Raytracer::Stats::local());
+
+            if (pass.m_block > 1)
+                camera.render_blocks(scene, viewport, chunks[chunk_idx].first, chunks[chunk_idx].second, pass.m_block, pass.m_refine);
+            else
+                render_chunk(camera, scene, viewport, chunks[chunk_idx].first, chunks[chunk_idx].second, pass);
+
+            RAYTRACER_STATS(camera.m_stats.m_tiles[chunk_idx] = {
+                                chunks[chunk_idx].first,
+                                chunks[chunk_idx].second,
+                                std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(),
+                                Raytracer::Stats::local() - before });
+        }
+
+        RAYTRACER_STATS(camera.m_stats.m_workers[worker] = Raytracer::Stats::local());
+    }
+
+    // Renders every chunk into the radiance buffer; false if stopped.
+    bool render_pass(Scene const& scene, std::size_t workers, std::stop_token const& stop, Pass const& pass = {})
+    {
+        auto const chunks = get_chunks();
+        auto next_chunk = std::atomic_size_t {};
+
+        if (!workers)
+            workers = std::max(1u, std::thread::hardware_concurrency());
+
+#ifdef RAYTRACER_ENABLE_STATS
+        auto const start = std::chrono::steady_clock::now();
+
+        m_stats = {
+            .m_width = m_viewport_width,
+            .m_height = m_viewport_height,
+            .m_cost = std::vector<uint64_t>(m_radiance.size()),
+            .m_tiles = std::vector<Raytracer::Stats::Tile>(chunks.size()),
+            .m_workers = std::vector<Raytracer::Stats::Counters>(workers),
+            .m_total = {},
+        };
+#endif
+
+        {
+            auto threads = std::vector<std::jthread> {};
+            threads.reserve(workers);
+
+            for (auto i = 0uz; i < workers; i++)
+                threads.emplace_back(
+                    render_worker,
+                    std::cref(*this),
+                    std::cref(scene),
+                    std::ref(m_radiance),
+                    std::cref(chunks),
+                    std::ref(next_chunk),
+                    i,
+                    std::cref(stop),
+                    std::cref(pass));
+
+            // Leaving the scope joins the workers
         }
 
-        while (finished_workers != MULTITHREAD_WORKERS) { };
+#ifdef RAYTRACER_ENABLE_STATS
+        for (auto&& counters : m_stats.m_workers)
+            m_stats.m_total.merge(counters);
+
+        m_stats.m_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+#endif
+
+        if (!pass.m_accumulate)
+            m_accumulated = 0;
+
+        return !stop.stop_requested();
+    }
+
+    /**
+     * Tone maps the radiance buffer into the 8 bit image, split into bands of rows over the workers
+     *
+     * Returns a view of the image, valid until the next resolve() or take_pixels().
+     */
+    std::span<Vec3<uint8_t> const> resolve(std::size_t workers = MULTITHREAD_WORKERS)
+    {
+        if (!workers)
+            workers = std::max(1u, std::thread::hardware_concurrency());
+
+        // After take_pixels()
+        m_pixels.resize(m_radiance.size());
+
+        auto const scale = 1.f / std::max<std::size_t>(1, m_accumulated);
+        auto const rows = (m_viewport_height + workers - 1) / workers;
+
+        {
+            auto threads = std::vector<std::jthread> {};
+            threads.reserve(workers);
+
+            for (auto first = 0uz; first < m_viewport_height; first += rows)
+                threads.emplace_back([&, first] {
+                    auto const offset = first * m_viewport_width;
+                    auto const count = (std::min<std::size_t>(first + rows, m_viewport_height) - first) * m_viewport_width;
+
+                    Raytracer::ToneMap::apply(
+                        std::span(m_radiance).subspan(offset, count),
+                        scale,
+                        m_tone_mapping,
+                        std::span(m_pixels).subspan(offset, count));
+                });
+        }
 
         return m_pixels;
     }
+
+    // Moves the image of the last resolve() out of the camera, e.g. to write it while the next frame renders.
+    std::vector<Vec3<uint8_t>> take_pixels() { return std::exchange(m_pixels, {}); }
+
+    // Linear colors of the last render, the sum of accumulated() passes of them after accumulate()
+    std::span<Vec3<float> const> get_radiance() const { return m_radiance; }
+    auto get_accumulated() const { return m_accumulated; }
+
+    /**
+     * Renders the scene with the given number of worker threads, or one per hardware thread if zero
+     *
+     * Returns a view of the image, see resolve(); the camera keeps the image, nothing is copied.
+     */
+    __attribute__((flatten)) std::span<Vec3<uint8_t> const> render(Scene const& scene, std::size_t workers = MULTITHREAD_WORKERS)
+    {
+        render_pass(scene, workers, {});
+
+        return resolve(workers);
+    }
+
+    /**
+     * Adds one sample per pixel to the radiance buffer, at the next of the positions of grid sampling
+     *
+     * The passes cycle through the m_grid_size x m_grid_size positions render_grid() uses, so after as many of
+     * them resolve() gives the image of grid sampling, up to the rounding of the float sums, and every pass
+     * in between a usable one. They trace like center sampling, whatever the mode and pipeline. Starts over
+     * after a render() or a change of view or sampling; returns the number of passes summed.
+     */
+    std::size_t accumulate(Scene const& scene, std::size_t workers = MULTITHREAD_WORKERS)
+    {
+        auto const n = std::max<std::size_t>(1, m_sampling.m_grid_size);
+        auto const sample = m_accumulated % (n * n);
+
+        render_pass(
+            scene,
+            workers,
+            {},
+            {
+                .m_accumulate = true,
+                .m_add = m_accumulated > 0,
+                .m_x = (sample / n + T { .5 }) / n,
+                .m_y = (sample % n + T { .5 }) / n,
+            });
+
+        return ++m_accumulated;
+    }
+
+    /**
+     * Renders the scene coarse to fine, calling on_pass(block, pixels) after every pass
+     *
+     * The first pass traces one ray per block x block square of pixels, every following one halves the
+     * squares, and the last is render() itself, with block 1 and the image render() returns. block is rounded
+     * down to a power of two of at most 64; the previews add a quarter of the primary rays of a render with
+     * one sample per pixel.
+     *
+     * Once stop is requested, workers finish the chunk they are on and the render returns false without
+     * calling on_pass() again, e.g. to start over after the camera moved. on_pass() runs on the calling thread
+     * and may request the stop itself.
+     */
+    bool render_progressive(Scene const& scene, auto on_pass, std::stop_token const& stop = {}, std::size_t block = 8, std::size_t workers = MULTITHREAD_WORKERS)
+    {
+        block = std::bit_floor(std::clamp<std::size_t>(block, 1, 64));
+
+        for (auto size = block; size > 1; size /= 2) {
+            if (!render_pass(scene, workers, stop, { .m_block = size, .m_refine = size < block }))
+                return false;
+
+            on_pass(size, resolve(workers));
+        }
+
+        if (!render_pass(scene, workers, stop))
+            return false;
+
+        on_pass(1uz, resolve(workers));
+
+        return true;
+    }
 };
+
+using Camera = BasicCamera<double>;
@@ -0,0 +1,450 @@
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Camera.h"
+#include "Scene.h"
+#include "SceneFile.h"
+#include "util/Binary.h"
+#include "util/Sampling.h"
+#include "util/Vec.h"
+
+/**
+ * Rendering a frame with worker processes
+ *
+ * A coordinator listens on a Unix socket and workers connect to it, see Raytracer::Distributed::serve(). The
+ * coordinator sends every worker the built scene once, as a snapshot (see SceneFile::write_snapshot()), and
+ * then, for every frame, the view and sampling of the camera followed by the chunks of Camera::get_chunks()
+ * to render. Workers answer each chunk with its pixels, which the coordinator stitches into the image.
+ *
+ * Chunks are handed out as workers return them, a few at a time so that no worker waits for its next one.
+ * The chunks of a worker that disconnects go to the others. Workers must be the same build as the
+ * coordinator, like readers of a scene cache.
+ */
+
+namespace Raytracer {
+
+namespace Distributed {
+    namespace Detail {
+        enum class Message : uint32_t {
+            Scene,  // Coordinator: a scene snapshot
+            Frame,  // Coordinator: the camera of the chunks that follow
+            Chunk,  // Coordinator: a chunk to render; worker: the chunk and its pixels
+            Done,   // Coordinator: no more frames
+        };
+
+        struct Header {
+            Message m_type;
+            uint32_t m_reserved;
+            uint64_t m_size;
+        };
+
+        template <std::floating_point T>
+        struct Frame {
+            uint32_t m_frame;
+            Vec3<T> m_eye;
+            Vec3<T> m_look_at;
+            Vec3<T> m_up;
+            Sampling m_sampling;
+            Pipeline m_pipeline;
+            ToneMapping m_tone_mapping;
+            Tiling m_tiling;
+        };
+
+        struct Chunk {
+            uint32_t m_frame;
+            uint32_t m_u;
+            uint32_t m_v;
+        };
+
+        bool inline send_bytes(int socket, void const* data, std::size_t size)
+        {
+            auto const* bytes = static_cast<uint8_t const*>(data);
+
+            while (size) {
+                auto const sent = ::send(socket, bytes, size, MSG_NOSIGNAL);
+
+                if (sent <= 0)
+                    return false;
+
+                bytes += sent;
+                size -= sent;
+            }
+
+            return true;
+        }
+
+        bool inline receive_bytes(int socket, void* data, std::size_t size)
+        {
+            auto* bytes = static_cast<uint8_t*>(data);
+
+            while (size) {
+                auto const received = ::recv(socket, bytes, size, 0);
+
+                if (received <= 0)
+                    return false;
+
+                bytes += received;
+                size -= received;
+            }
+
+            return true;
+        }
+
+        bool inline send(int socket, Message type, std::span<uint8_t const> payload)
+        {
+            auto const header = Header { type, 0, payload.size() };
+
+            return send_bytes(socket, &header, sizeof(header)) && send_bytes(socket, payload.data(), payload.size());
+        }
+
+        template <Raytracer::Binary::Raw U>
+        bool send(int socket, Message type, U const& value)
+        {
+            return send(socket, type, std::span(reinterpret_cast<uint8_t const*>(&value), sizeof(U)));
+        }
+
+        bool inline receive(int socket, Message& type, std::vector<uint8_t>& payload)
+        {
+            auto header = Header {};
+
+            if (!receive_bytes(socket, &header, sizeof(header)))
+                return false;
+
+            type = header.m_type;
+            payload.resize(header.m_size);
+
+            return receive_bytes(socket, payload.data(), payload.size());
+        }
+
+        bool inline make_address(std::string const& path, sockaddr_un& address)
+        {
+            address = {};
+            address.sun_family = AF_UNIX;
+
+            if (path.size() >= sizeof(address.sun_path))
+                return false;
+
+            std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+            return true;
+        }
+    }
+
+    /**
+     * Runs a worker for the coordinator listening at path, until it is done with the worker
+     *
+     * Returns false if the coordinator could not be reached or sent something this build can not render.
+     */
+    template <std::floating_point T>
+    bool serve(std::string const& path)
+    {
+        using namespace Detail;
+
+        auto address = sockaddr_un {};
+        auto const socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+        if (socket < 0)
+            return false;
+
+        if (!make_address(path, address) || ::connect(socket, reinterpret_cast<sockaddr const*>(&address), sizeof(address)) != 0) {
+            ::close(socket);
+            return false;
+        }
+
+        auto scene = BasicScene<T> {};
+        auto camera = std::optional<BasicCamera<T>> {};
+        auto frame = uint32_t {};
+
+        auto type = Message {};
+        auto payload = std::vector<uint8_t> {};
+        auto ok = true;
+
+        while (ok && receive(socket, type, payload)) {
+            auto reader = Raytracer::Binary::Reader(std::string_view(reinterpret_cast<char const*>(payload.data()), payload.size()));
+
+            if (type == Message::Done)
+                break;
+
+            switch (type) {
+            case Message::Scene: {
+                auto description = BasicSceneDescription<T> {};
+
+                scene = BasicScene<T> {};
+                ok = Raytracer::SceneFile::read_snapshot(reader, scene, description) && reader.at_end();
+
+                if (ok)
+                    camera.emplace(description.make_camera());
+
+                break;
+            }
+            case Message::Frame: {
+                auto settings = Detail::Frame<T> {};
+
+                ok = camera && reader.read(settings) && reader.at_end();
+
+                if (ok) {
+                    camera->set_view(settings.m_eye, settings.m_look_at, settings.m_up);
+                    camera->set_sampling(settings.m_sampling);
+                    camera->set_pipeline(settings.m_pipeline);
+                    camera->set_tone_mapping(settings.m_tone_mapping);
+                    camera->set_tiling(settings.m_tiling);
+                    frame = settings.m_frame;
+                }
+
+                break;
+            }
+            case Message::Chunk: {
+                auto chunk = Chunk {};
+
+                ok = camera && reader.read(chunk) && reader.at_end() && chunk.m_frame == frame;
+
+                if (!ok)
+                    break;
+
+                auto const pixels = camera->render_tile(scene, chunk.m_u, chunk.m_v);
+                auto writer = Raytracer::Binary::Writer {};
+
+                writer.write(chunk);
+                writer.write_bytes(pixels.data(), pixels.size() * sizeof(pixels[0]));
+
+                ok = send(socket, Message::Chunk, writer.get_data());
+                break;
+            }
+            default:
+                ok = false;
+            }
+        }
+
+        ::close(socket);
+
+        return ok;
+    }
+}
+
+}
+
+/**
+ * The coordinator of the workers rendering a scene, see Distributed.h
+ *
+ * listen() and accept() gather the workers, send_scene() hands them the scene and render() renders a frame
+ * with them as often as needed, e.g. once for every frame of an animation; the scene only has to be sent
+ * again if it changed. Workers that fail are dropped, a render only fails once all of them have.
+ */
+template <std::floating_point T>
+class BasicRenderCoordinator {
+private:
+    using Scene = BasicScene<T>;
+    using Camera = BasicCamera<T>;
+    using SceneDescription = BasicSceneDescription<T>;
+
+    int m_listener;
+    std::string m_path;
+    std::vector<int> m_workers;
+    uint32_t m_frame;
+
+    void drop(std::size_t worker)
+    {
+        ::close(m_workers[worker]);
+        m_workers.erase(m_workers.begin() + worker);
+    }
+
+public:
+    BasicRenderCoordinator()
+        : m_listener(-1)
+        , m_path({})
+        , m_workers({})
+        , m_frame(0) {};
+
+    BasicRenderCoordinator(BasicRenderCoordinator const&) = delete;
+    BasicRenderCoordinator& operator=(BasicRenderCoordinator const&) = delete;
+
+    // Tells the workers there is nothing more to render
+    ~BasicRenderCoordinator()
+    {
+        for (auto worker : m_workers) {
+            Raytracer::Distributed::Detail::send(worker, Raytracer::Distributed::Detail::Message::Done, std::span<uint8_t const> {});
+            ::close(worker);
+        }
+
+        if (m_listener >= 0) {
+            ::close(m_listener);
+            ::unlink(m_path.c_str());
+        }
+    }
+
+    // Listens for workers on a Unix socket created at path; returns false if it could not be.
+    bool listen(std::string const& path)
+    {
+        auto address = sockaddr_un {};
+
+        if (m_listener >= 0 || !Raytracer::Distributed::Detail::make_address(path, address))
+            return false;
+
+        m_listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        m_path = path;
+
+        ::unlink(path.c_str());
+
+        return m_listener >= 0
+            && ::bind(m_listener, reinterpret_cast<sockaddr const*>(&address), sizeof(address)) == 0
+            && ::listen(m_listener, SOMAXCONN) == 0;
+    }
+
+    // Waits until count more workers connected; returns false if accepting one failed.
+    bool accept(std::size_t count)
+    {
+        for (auto i = 0uz; i < count; i++) {
+            auto const worker = ::accept(m_listener, nullptr, nullptr);
+
+            if (worker < 0)
+                return false;
+
+            m_workers.push_back(worker);
+        }
+
+        return true;
+    }
+
+    std::size_t get_worker_count() const { return m_workers.size(); }
+
+    // Sends a built scene to every worker; returns false if there are none left that took it.
+    bool send_scene(Scene const& scene, SceneDescription const& description)
+    {
+        auto writer = Raytracer::Binary::Writer {};
+
+        if (!Raytracer::SceneFile::write_snapshot(writer, scene, description))
+            return false;
+
+        for (auto worker = m_workers.size(); worker-- > 0;)
+            if (!Raytracer::Distributed::Detail::send(m_workers[worker], Raytracer::Distributed::Detail::Message::Scene, writer.get_data()))
+                drop(worker);
+
+        return !m_workers.empty();
+    }
+
+    /**
+     * Renders a frame of the scene last sent, as the camera sees it, into pixels
+     *
+     * The camera must have the resolution of the scene description; its view, sampling, pipeline and tiling
+     * are the ones the workers use. Every worker is given up to in_flight chunks at once. Returns false if
+     * all workers failed before the frame was complete.
+     */
+    bool render(Camera const& camera, std::vector<Vec3<uint8_t>>& pixels, std::size_t in_flight = 2)
+    {
+        using namespace Raytracer::Distributed::Detail;
+
+        auto const chunks = camera.get_chunks();
+        auto const width = static_cast<std::size_t>(camera.get_width());
+        auto const height = static_cast<std::size_t>(camera.get_height());
+
+        auto const settings = Frame<T> { ++m_frame, camera.get_eye(), camera.get_look_at(), camera.get_up(), camera.get_sampling(), camera.get_pipeline(), camera.get_tone_mapping(), camera.get_tiling() };
+
+        for (auto worker = m_workers.size(); worker-- > 0;)
+            if (!send(m_workers[worker], Message::Frame, settings))
+                drop(worker);
+
+        pixels.assign(width * height, Vec3<uint8_t> { 0 });
+
+        // Chunks not handed out yet, and the ones every worker is rendering
+        auto pending = std::deque<uint32_t>(chunks.size());
+        auto assigned = std::vector<std::vector<uint32_t>>(m_workers.size());
+        auto completed = 0uz;
+
+        for (auto i = 0u; i < chunks.size(); i++)
+            pending[i] = i;
+
+        auto give_out = [&](std::size_t worker) {
+            while (assigned[worker].size() < in_flight && !pending.empty()) {
+                auto const chunk = pending.front();
+
+                if (!send(m_workers[worker], Message::Chunk, Chunk { m_frame, static_cast<uint32_t>(chunks[chunk].first), static_cast<uint32_t>(chunks[chunk].second) }))
+                    return false;
+
+                pending.pop_front();
+                assigned[worker].push_back(chunk);
+            }
+
+            return true;
+        };
+
+        auto fail = [&](std::size_t worker) {
+            pending.insert(pending.begin(), assigned[worker].begin(), assigned[worker].end());
+            assigned.erase(assigned.begin() + worker);
+            drop(worker);
+        };
+
+        auto poll_fds = std::vector<pollfd> {};
+        auto type = Message {};
+        auto payload = std::vector<uint8_t> {};
+
+        while (completed < chunks.size()) {
+            for (auto worker = m_workers.size(); worker-- > 0;)
+                if (!give_out(worker))
+                    fail(worker);
+
+            if (m_workers.empty())
+                return false;
+
+            poll_fds.clear();
+
+            for (auto worker : m_workers)
+                poll_fds.push_back({ worker, POLLIN, 0 });
+
+            if (::poll(poll_fds.data(), poll_fds.size(), -1) < 0)
+                return false;
+
+            for (auto worker = m_workers.size(); worker-- > 0;) {
+                if (!poll_fds[worker].revents)
+                    continue;
+
+                if (!receive(m_workers[worker], type, payload) || type != Message::Chunk) {
+                    fail(worker);
+                    continue;
+                }
+
+                auto reader = Raytracer::Binary::Reader(std::string_view(reinterpret_cast<char const*>(payload.data()), payload.size()));
+                auto chunk = Chunk {};
+                reader.read(chunk);
+
+                // Only chunks of this frame the worker was given are taken
+                auto const given = std::find_if(assigned[worker].begin(), assigned[worker].end(), [&](auto index) {
+                    return chunks[index].first == chunk.m_u && chunks[index].second == chunk.m_v;
+                });
+
+                auto const [i0, i1, j0, j1] = camera.get_chunk_bounds(chunk.m_u, chunk.m_v);
+                auto const tile_width = i1 - i0;
+                auto const tile_height = j1 - j0;
+
+                if (!reader.ok() || chunk.m_frame != m_frame || given == assigned[worker].end() || payload.size() != sizeof(chunk) + tile_width * tile_height * sizeof(pixels[0])) {
+                    fail(worker);
+                    continue;
+                }
+
+                // Rows of the tile are top first, like the image
+                for (auto row = 0uz; row < tile_height; row++)
+                    reader.read_bytes(&pixels[(height - (j0 + tile_height - row)) * width + i0], tile_width * sizeof(pixels[0]));
+
+                assigned[worker].erase(given);
+                completed++;
+            }
+        }
+
+        return true;
+    }
+};
+
+using RenderCoordinator = BasicRenderCoordinator<double>;
@@ -1,117 +1,677 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <concepts>
+#include <cstdint>
+#include <limits>
 #include <memory>
+#include <type_traits>
+#include <typeinfo>
 #include <vector>
 
 #include "shapes/Shape.h"
+#include "shapes/ShapeArrays.h"
+#include "util/BVH.h"
+#include "util/Binary.h"
 #include "util/Config.h"
 #include "util/Light.h"
 #include "util/Lighting.h"
 #include "util/Ray.h"
+#include "util/RayPacket.h"
 #include "util/Record.h"
+#include "util/Stats.h"
 #include "util/Vec.h"
 
-class Scene {
+template <std::floating_point T>
+class BasicScene {
 private:
-    std::vector<std::shared_ptr<Shape>> m_shapes;
-    std::vector<std::shared_ptr<Light>> m_lights;
+    using Ray = BasicRay<T>;
+    using RayPacket = BasicRayPacket<T>;
+    using Hit = BasicHit<T>;
+    using PacketHit = BasicPacketHit<T>;
+    using PacketMask = PacketMaskOf<T>;
+
+    std::vector<std::shared_ptr<BasicShape<T>>> m_shapes;
+    std::vector<std::shared_ptr<BasicLight<T>>> m_lights;
+    std::vector<BasicMaterial<T>> m_materials;
+
+    // Indices into m_shapes. Shapes with a finite bounding box live in the BVH, the others are tested for
+    // every ray; planes are kept in m_planes instead.
+    std::vector<uint32_t> m_bounded_shapes;
+    std::vector<uint32_t> m_unbounded_shapes;
+    BasicBVH<T> m_bvh;
+
+    // Spheres, triangles and planes are copied into arrays per type and intersected with batched kernels,
+    // the bounded ones in the order of the leaves of the BVH; shapes of other types are called through
+    // their virtual methods.
+    BasicSphereArray<T> m_spheres;
+    BasicTriangleArray<T> m_triangles;
+    BasicPlaneArray<T> m_planes;
+    std::vector<uint32_t> m_other_shapes;
+
+    // Ranges of the arrays above holding the shapes of a BVH leaf, at the index of its first BVH entry
+    struct Leaf {
+        uint32_t m_spheres;
+        uint32_t m_triangles;
+        uint32_t m_others;
+        uint16_t m_sphere_count;
+        uint16_t m_triangle_count;
+        uint16_t m_other_count;
+    };
+
+    std::vector<Leaf> m_leaves;
+
+    // Lights with a range are found through a BVH over the boxes around their ranges, the others light every
+    // point; both are indices into m_lights.
+    std::vector<uint32_t> m_bounded_lights;
+    std::vector<uint32_t> m_unbounded_lights;
+    BasicBVH<T> m_light_bvh;
+
+    LightSampling m_light_sampling;
+
+    bool m_built;
+
+    // Random number in [0, 1) from a seed, the same for the same seed
+    static T random(uint64_t seed)
+    {
+        seed += 0x9e3779b97f4a7c15;
+        seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9;
+        seed = (seed ^ (seed >> 27)) * 0x94d049bb133111eb;
+        seed ^= seed >> 31;
+
+        return static_cast<T>((seed >> 11) * 0x1p-53);
+    }
+
+    // Fills the shape arrays and the leaves from the shapes and the BVH
+    void arrange()
+    {
+        m_spheres.clear();
+        m_triangles.clear();
+        m_planes.clear();
+        m_other_shapes.clear();
+
+        for (auto id = 0u; id < m_shapes.size(); id++) {
+            auto const& shape = *m_shapes[id];
+
+            if (!shape.get_bounding_box().is_bounded() && typeid(shape) == typeid(BasicPlane<T>))
+                m_planes.add(static_cast<BasicPlane<T> const&>(shape), id);
+        }
+
+        // Group the shapes of every leaf by type, exact types only since subclasses may intersect differently
+        m_leaves.assign(m_bounded_shapes.size(), {});
+
+        for (auto&& node : m_bvh.get_nodes()) {
+            if (!node.is_leaf())
+                continue;
+
+            auto leaf = Leaf {
+                .m_spheres = m_spheres.size(),
+                .m_triangles = m_triangles.size(),
+                .m_others = static_cast<uint32_t>(m_other_shapes.size()),
+                .m_sphere_count = 0,
+                .m_triangle_count = 0,
+                .m_other_count = 0
+            };
+
+            for (auto i = node.m_offset; i < node.m_offset + node.m_count; i++) {
+                auto const id = m_bounded_shapes[m_bvh.get_indices()[i]];
+                auto const& shape = *m_shapes[id];
+
+                if (typeid(shape) == typeid(BasicSphere<T>)) {
+                    m_spheres.add(static_cast<BasicSphere<T> const&>(shape), id);
+                    leaf.m_sphere_count++;
+                } else if (typeid(shape) == typeid(BasicTriangle<T>)) {
+                    m_triangles.add(static_cast<BasicTriangle<T> const&>(shape), id);
+                    leaf.m_triangle_count++;
+                } else {
+                    m_other_shapes.push_back(id);
+                    leaf.m_other_count++;
+                }
+            }
+
+            m_leaves[node.m_offset] = leaf;
+        }
+
+        m_spheres.pad();
+        m_triangles.pad();
+        m_planes.pad();
+    }
 
 public:
-    Scene()
+    BasicScene()
         : m_shapes({})
-        , m_lights({}) {};
+        , m_lights({})
+        , m_materials({})
+        , m_bounded_shapes({})
+        , m_unbounded_shapes({})
+        , m_bvh({})
+        , m_spheres({})
+        , m_triangles({})
+        , m_planes({})
+        , m_other_shapes({})
+        , m_leaves({})
+        , m_bounded_lights({})
+        , m_unbounded_lights({})
+        , m_light_bvh({})
+        , m_light_sampling({})
+        , m_built(false) {};
 
     void add_light(auto light)
     {
         m_lights.push_back(light);
     }
 
+    MaterialId add_material(BasicMaterial<T> const& material)
+    {
+        m_materials.push_back(material);
+
+        return static_cast<MaterialId>(m_materials.size() - 1);
+    }
+
     void add_shape(auto shape)
     {
         m_shapes.push_back(shape);
+        m_built = false;
+    }
+
+    // Must be called after the last add_shape() and before rendering.
+    void build()
+    {
+        auto boxes = std::vector<BasicBoundingBox<T>> {};
+
+        m_bounded_shapes.clear();
+        m_unbounded_shapes.clear();
+
+        for (auto id = 0u; id < m_shapes.size(); id++) {
+            auto const& shape = m_shapes[id];
+
+            assert(shape->get_material(0) < m_materials.size());
+
+            if (shape->get_bounding_box().is_bounded()) {
+                m_bounded_shapes.push_back(id);
+                boxes.push_back(shape->get_bounding_box());
+            } else if (typeid(*shape) != typeid(BasicPlane<T>)) {
+                m_unbounded_shapes.push_back(id);
+            }
+        }
+
+        m_bvh.build(boxes);
+        arrange();
+        update_lights();
+
+        m_built = true;
+    }
+
+    /**
+     * Updates a built scene after its shapes were moved with translate(), keeping the hierarchy of the BVH
+     * and refitting its bounds. Much cheaper than build(), for animations where the same shapes move a bit
+     * every frame; the BVH gets slower to traverse as they move further from where it was built.
+     */
+    void refit()
+    {
+        assert(m_built);
+
+        auto boxes = std::vector<BasicBoundingBox<T>> {};
+        boxes.reserve(m_bounded_shapes.size());
+
+        for (auto id : m_bounded_shapes)
+            boxes.push_back(m_shapes[id]->get_bounding_box());
+
+        m_bvh.refit(boxes);
+        arrange();
+        update_lights();
+    }
+
+    // Must be called after lights are added, moved or change their range once the scene is built.
+    void update_lights()
+    {
+        auto boxes = std::vector<BasicBoundingBox<T>> {};
+
+        m_bounded_lights.clear();
+        m_unbounded_lights.clear();
+
+        for (auto id = 0u; id < m_lights.size(); id++) {
+            auto const& light = *m_lights[id];
+
+            if (light.is_bounded()) {
+                m_bounded_lights.push_back(id);
+                boxes.push_back({ light.m_position - light.m_range, light.m_position + light.m_range });
+            } else {
+                m_unbounded_lights.push_back(id);
+            }
+        }
+
+        m_light_bvh.build(boxes);
+    }
+
+    void set_light_sampling(LightSampling const& sampling) { m_light_sampling = sampling; }
+
+    // A light to shade a point with, and what its light is multiplied by
+    struct LightSample {
+        uint32_t m_light;
+        T m_weight;
+    };
+
+    /**
+     * Lights to shade a point with
+     *
+     * Exactly, these are all lights in range of the point in the order they were added, weighted by their
+     * falloff. Sampled, m_samples of them are drawn at random with probabilities in proportion to an estimate
+     * of the light they bring (color, falloff and the angle to the normal), and weighted so that the expected
+     * sum equals the exact one. The random numbers come from the point, so images do not change between runs.
+     */
+    void select_lights(Vec3<T> const& point, Vec3<T> const& normal, std::vector<LightSample>& samples) const
+    {
+        samples.clear();
+
+        if (m_bounded_lights.empty()) {
+            for (auto id = 0u; id < m_lights.size(); id++)
+                samples.push_back({ id, T { 1 } });
+        } else {
+            for (auto id : m_unbounded_lights)
+                samples.push_back({ id, T { 1 } });
+
+            m_light_bvh.query(point, [&](uint32_t index) {
+                auto const id = m_bounded_lights[index];
+                auto const offset = m_lights[id]->m_position - point;
+                auto const falloff = m_lights[id]->falloff(dot(offset, offset));
+
+                if (falloff > 0)
+                    samples.push_back({ id, falloff });
+            });
+
+            std::sort(samples.begin(), samples.end(), [](auto const& a, auto const& b) { return a.m_light < b.m_light; });
+        }
+
+        if (m_light_sampling.m_mode == LightMode::Exact || samples.size() <= m_light_sampling.m_samples)
+            return;
+
+        thread_local auto candidates = std::vector<LightSample> {};
+        thread_local auto cumulative = std::vector<T> {};
+
+        candidates.swap(samples);
+        cumulative.clear();
+        samples.clear();
+
+        auto total = T { 0 };
+
+        for (auto& candidate : candidates) {
+            auto const& light = *m_lights[candidate.m_light];
+
+            // Lights behind the surface still add their ambient term
+            auto const cosine = std::max(T { .1 }, dot(normal, normalize(light.m_position - point)));
+            auto const estimate = candidate.m_weight * cosine * (light.m_color.x + light.m_color.y + light.m_color.z);
+
+            total += estimate;
+            cumulative.push_back(total);
+
+            // Weight of the light per unit of probability
+            candidate.m_weight = estimate > 0 ? candidate.m_weight / estimate : 0;
+        }
+
+        if (!(total > 0))
+            return;
+
+        auto seed = uint64_t {};
+
+        point.for_each_const([&](auto const& a, auto) {
+            seed = seed * 0x100000001b3 ^ std::bit_cast<std::conditional_t<sizeof(T) == 8, uint64_t, uint32_t>>(a);
+        });
+
+        auto const count = m_light_sampling.m_samples;
+
+        for (auto i = 0uz; i < count; i++) {
+            auto const u = random(seed + i) * total;
+            auto const chosen = std::min(static_cast<std::size_t>(std::upper_bound(cumulative.begin(), cumulative.end(), u) - cumulative.begin()), candidates.size() - 1);
+
+            samples.push_back({ candidates[chosen].m_light, candidates[chosen].m_weight * total / count });
+        }
     }
 
     auto const& get_lights() const { return m_lights; }
 
     auto const& get_shapes() const { return m_shapes; }
 
-    auto find_intersection(Ray const& ray, double min, double max, Record& record) const
+    auto const& get_material(MaterialId id) const { return m_materials[id]; }
+
+    auto const& get_materials() const { return m_materials; }
+
+    // Snapshot of what build() computed from the shapes; the shapes themselves are not included.
+    void write_build(Raytracer::Binary::Writer& writer) const
     {
-        auto time = max;
+        assert(m_built);
 
-        for (auto&& shape : m_shapes) {
-            if (!shape->get_bounding_box().find_intersection(ray))
-                continue;
+        writer.write(m_bounded_shapes);
+        writer.write(m_unbounded_shapes);
+        m_bvh.write(writer);
+        m_spheres.write(writer);
+        m_triangles.write(writer);
+        m_planes.write(writer);
+        writer.write(m_other_shapes);
+        writer.write(m_leaves);
+    }
+
+    // Restores a snapshot written for the same shapes, added in the same order, in place of build().
+    bool read_build(Raytracer::Binary::Reader& reader)
+    {
+        reader.read(m_bounded_shapes);
+        reader.read(m_unbounded_shapes);
+        m_bvh.read(reader);
+        m_spheres.read(reader);
+        m_triangles.read(reader);
+        m_planes.read(reader);
+        reader.read(m_other_shapes);
+        reader.read(m_leaves);
+
+        if (!reader.ok() || m_leaves.size() != m_bounded_shapes.size())
+            return false;
+
+        update_lights();
+
+        for (auto const* ids : { &m_bounded_shapes, &m_unbounded_shapes, &m_other_shapes })
+            for (auto id : *ids)
+                if (id >= m_shapes.size())
+                    return false;
+
+        m_built = true;
 
-            auto time_of_intersection = shape->find_intersection(ray, min, max);
+        return true;
+    }
+
+    bool find_intersection(Ray const& ray, T min, T max, Hit& hit) const
+    {
+        assert(m_built);
+
+        hit.m_time = max;
+
+        auto intersect = [&](uint32_t id, T max) {
+            auto element = 0u;
+            auto const time_of_intersection = m_shapes[id]->find_intersection(ray, min, max, element);
+
+            if (time_of_intersection > min && time_of_intersection < max)
+                hit = { time_of_intersection, id, element };
 
-            if (time_of_intersection > min && time_of_intersection < time) {
-                time = time_of_intersection;
+            return time_of_intersection;
+        };
 
-                auto point = ray.get_point(time);
+        hit.m_time = m_planes.find_intersection(ray, 0, m_planes.size(), min, hit.m_time, hit);
 
-                record = {
-                    .m_material = shape->get_material(),
-                    .m_time = time,
-                    .m_point = point,
-                    .m_normal = shape->get_normal(point)
-                };
+        for (auto id : m_unbounded_shapes)
+            intersect(id, hit.m_time);
+
+        m_bvh.traverse_leaves(ray, min, hit.m_time, [&](uint32_t first, uint32_t, T max) {
+            auto const& leaf = m_leaves[first];
+
+            max = m_spheres.find_intersection(ray, leaf.m_spheres, leaf.m_sphere_count, min, max, hit);
+            max = m_triangles.find_intersection(ray, leaf.m_triangles, leaf.m_triangle_count, min, max, hit);
+
+            for (auto i = leaf.m_others; i < leaf.m_others + leaf.m_other_count; i++) {
+                auto const time = intersect(m_other_shapes[i], max);
+
+                if (time > min && time < max)
+                    max = time;
             }
+
+            return max;
+        });
+
+        return hit.m_time != max;
+    }
+
+    // Closest hits for the active lanes of a packet; returns the lanes that hit anything.
+    PacketMask find_intersection(RayPacket const& packet, PacketMask active, T min, PacketHit& hit) const
+    {
+        assert(m_built);
+
+        auto hits = PacketMask {};
+
+        auto intersect = [&](uint32_t id, PacketMask mask) {
+            auto elements = PacketIndexOf<T> {};
+            auto const closer = m_shapes[id]->find_intersection(packet, mask, min, hit.m_time, elements);
+
+            hit.m_shape = closer ? static_cast<Raytracer::Packet::Integer<T>>(id) : hit.m_shape;
+            hit.m_element = closer ? elements : hit.m_element;
+            hits |= closer;
+        };
+
+        hits |= m_planes.find_intersection(packet, active, 0, m_planes.size(), min, hit);
+
+        for (auto id : m_unbounded_shapes)
+            intersect(id, active);
+
+        m_bvh.traverse_leaves(packet, active, min, hit.m_time, [&](uint32_t first, uint32_t, PacketMask mask) {
+            auto const& leaf = m_leaves[first];
+
+            hits |= m_spheres.find_intersection(packet, mask, leaf.m_spheres, leaf.m_sphere_count, min, hit);
+            hits |= m_triangles.find_intersection(packet, mask, leaf.m_triangles, leaf.m_triangle_count, min, hit);
+
+            for (auto i = leaf.m_others; i < leaf.m_others + leaf.m_other_count; i++)
+                intersect(m_other_shapes[i], mask);
+        });
+
+        return hits;
+    }
+
+    // Computes the shading data for the closest hit found by find_intersection().
+    BasicRecord<T> resolve(Ray const& ray, Hit const& hit) const
+    {
+        auto const& shape = m_shapes[hit.m_shape];
+        auto const point = ray.get_point(hit.m_time);
+
+        return {
+            .m_material = m_materials[shape->get_material(hit.m_element)],
+            .m_time = hit.m_time,
+            .m_point = point,
+            .m_normal = shape->get_normal(point, hit.m_element)
+        };
+    }
+
+    // Whether anything lies along the ray inside of (min, max); stops at the first intersection found.
+    bool is_occluded(Ray const& ray, T min, T max) const
+    {
+        auto occluder = BasicBVH<T>::no_node;
+
+        return is_occluded(ray, min, max, occluder);
+    }
+
+    // As above, testing the BVH leaf occluder (from the previous call) before searching the scene for others
+    bool is_occluded(Ray const& ray, T min, T max, uint32_t& occluder) const
+    {
+        assert(m_built);
+
+        if (m_planes.intersects(ray, 0, m_planes.size(), min, max))
+            return true;
+
+        for (auto id : m_unbounded_shapes)
+            if (m_shapes[id]->intersects(ray, min, max))
+                return true;
+
+        return m_bvh.occluded_leaves(ray, min, max, occluder, [&](uint32_t first, uint32_t) {
+            auto const& leaf = m_leaves[first];
+
+            if (m_spheres.intersects(ray, leaf.m_spheres, leaf.m_sphere_count, min, max)
+                || m_triangles.intersects(ray, leaf.m_triangles, leaf.m_triangle_count, min, max))
+                return true;
+
+            for (auto i = leaf.m_others; i < leaf.m_others + leaf.m_other_count; i++)
+                if (m_shapes[m_other_shapes[i]]->intersects(ray, min, max))
+                    return true;
+
+            return false;
+        });
+    }
+
+    /**
+     * Occluders of the calling thread for this scene, one per light, to pass to is_occluded()
+     *
+     * Neighbouring pixels mostly have their shadow rays towards a light blocked by the same shapes. Occluders
+     * are only hints, any node can be passed for any ray, so they stay valid as the scene is refit or built
+     * again and only start over for another scene or when lights are added.
+     */
+    std::vector<uint32_t>& occluders() const
+    {
+        thread_local auto scene = static_cast<BasicScene const*>(nullptr);
+        thread_local auto occluders = std::vector<uint32_t> {};
+
+        if (scene != this || occluders.size() != m_lights.size()) {
+            scene = this;
+            occluders.assign(m_lights.size(), BasicBVH<T>::no_node);
         }
 
-        return time != max;
+        return occluders;
     }
 
-    __attribute__((flatten)) auto compute_ray_color(Ray const& ray, double min, double max, int depth) const
+    __attribute__((flatten)) Vec3<T> compute_ray_color(Ray const& ray, T min, T max, int depth) const
     {
-        auto record = Record {};
+        auto hit = Hit {};
 
-        if (depth == RAYTRACER_MAX_RECURSION_DEPTH || !find_intersection(ray, min, max, record))
-            return Vec3<double> { 0. };
+        return compute_ray_color(ray, min, max, depth, hit);
+    }
+
+    // As above, also returning the closest hit; its shape is Hit::miss if nothing was hit.
+    __attribute__((flatten)) Vec3<T> compute_ray_color(Ray const& ray, T min, T max, int depth, Hit& hit) const
+    {
+        RAYTRACER_STATS(Raytracer::Stats::reach_depth(depth));
+
+        if (depth == RAYTRACER_MAX_RECURSION_DEPTH || !find_intersection(ray, min, max, hit)) {
+            hit.m_shape = Hit::miss;
+            return Vec3<T> { 0 };
+        }
+
+        return shade(ray, hit, depth);
+    }
+
+    /**
+     * Colors for a packet of coherent primary rays
+     *
+     * The closest hits are found for the whole packet at once, lighting and reflections are then traced per
+     * lane since secondary rays rarely stay coherent.
+     */
+    __attribute__((flatten)) std::array<Vec3<T>, Raytracer::Packet::width<T>> compute_ray_color(RayPacket const& packet, PacketMask active = ~PacketMask {}) const
+    {
+        auto hit = PacketHit {};
+
+        return compute_ray_color(packet, active, hit);
+    }
+
+    // As above, also returning the closest hits; lanes that hit nothing have their shape set to Hit::miss.
+    __attribute__((flatten)) std::array<Vec3<T>, Raytracer::Packet::width<T>> compute_ray_color(RayPacket const& packet, PacketMask active, PacketHit& hit) const
+    {
+        auto colors = std::array<Vec3<T>, Raytracer::Packet::width<T>> {};
+
+        hit = {
+            .m_time = PacketOf<T> {} + std::numeric_limits<T>::infinity(),
+            .m_shape = PacketIndexOf<T> {} + static_cast<Raytracer::Packet::Integer<T>>(Hit::miss),
+            .m_element = PacketIndexOf<T> {}
+        };
+
+        if constexpr (RAYTRACER_MAX_RECURSION_DEPTH == 0)
+            return colors;
+
+        auto const hits = find_intersection(packet, active, 0, hit);
+
+        for (auto lane = 0uz; lane < Raytracer::Packet::width<T>; lane++)
+            if (hits[lane])
+                colors[lane] = shade(
+                    packet.get_ray(lane),
+                    { hit.m_time[lane], static_cast<uint32_t>(hit.m_shape[lane]), static_cast<uint32_t>(hit.m_element[lane]) },
+                    0);
+
+        return colors;
+    }
+
+    // Ray from a point towards a light, with the distance to the light in light_time.
+    Ray get_shadow_ray(Vec3<T> const& point, BasicLight<T> const& light, T& light_time) const
+    {
+        auto light_direction = light.m_position - point;
+        light_time = light_direction.magnitude();
+
+        light_direction.normalize();
+
+        return Ray(point, light_direction);
+    }
 
-        auto color = Vec3<double> { 0. };
+    // Light reflected towards E at a hit by a light that is not occluded, in the normalized light_direction.
+    Vec3<T> illuminate(BasicRecord<T> const& record, Vec3<T> const& E, BasicLight<T> const& light, Vec3<T> const& light_direction) const
+    {
+        auto LN = dot(light_direction, record.m_normal);
+
+        auto diffuse = std::max(T { 0 }, LN) * record.m_material.kd;
+        auto specular = Vec3<T> { 0 };
+
+        // Don't compute specular component if specular reflection is negligible
+        if (dot(record.m_material.ks, record.m_material.ks) > Raytracer::Config::epsilon<T>)
+            specular = Raytracer::specular(
+                           light_direction,
+                           record.m_normal,
+                           E,
+                           T { 1 },
+                           record.m_material.ior,
+                           record.m_material.m)
+                       * record.m_material.ks;
+
+        return light.m_color * (record.m_material.ka + diffuse + specular);
+    }
+
+    Ray get_reflection_ray(Ray const& ray, BasicRecord<T> const& record) const
+    {
+        return Ray(record.m_point, normalize(ray.get_direction() - T { 2 } * dot(ray.get_direction(), record.m_normal) * record.m_normal));
+    }
+
+    // Whether a material reflects anything; reflection rays of the others would be multiplied by zero.
+    static bool reflects(BasicMaterial<T> const& material)
+    {
+        return material.km.x != 0 || material.km.y != 0 || material.km.z != 0;
+    }
+
+    // Adds the reflected color (already multiplied by km) to the light at a hit. Colors are linear and not
+    // clamped, values above 1 are left to the tone mapping of the camera.
+    static Vec3<T> combine(Vec3<T> const& color, Vec3<T> const& reflected_color)
+    {
+        return color + reflected_color;
+    }
+
+    // Lighting and reflections at the closest hit of a ray traced at the given recursion depth.
+    __attribute__((flatten)) Vec3<T> shade(Ray const& ray, Hit const& hit, int depth) const
+    {
+        auto const record = resolve(ray, hit);
+
+        auto color = Vec3<T> { 0 };
         auto E = normalize(ray.get_origin() - record.m_point);
 
-        for (auto&& light : m_lights) {
-            auto light_direction = light->m_position - record.m_point;
-            auto light_time = light_direction.magnitude();
+        // Reflection rays are only traced once the lights are done with
+        thread_local auto samples = std::vector<LightSample> {};
+        select_lights(record.m_point, record.m_normal, samples);
+
+        auto& occluders = this->occluders();
 
-            light_direction.normalize();
+        for (auto&& sample : samples) {
+            auto const& light = *m_lights[sample.m_light];
+            auto light_time = T {};
+            auto const shadow_ray = get_shadow_ray(record.m_point, light, light_time);
 
-            auto shadow_ray = Ray(record.m_point, light_direction);
-            auto shadow_record = Record {};
+            RAYTRACER_STATS(Raytracer::Stats::count(Raytracer::Stats::ShadowRays));
 
             // There is an occluder between light and this point; continue to next light source.
-            if (find_intersection(shadow_ray, RAYTRACER_EPSILON, light_time, shadow_record))
+            if (is_occluded(shadow_ray, Raytracer::Config::epsilon<T>, light_time, occluders[sample.m_light]))
                 continue;
 
-            auto LN = dot(light_direction, record.m_normal);
+            color += sample.m_weight * illuminate(record, E, light, shadow_ray.get_direction());
+        }
 
-            auto diffuse = std::max(0., LN) * record.m_material.kd;
-            auto specular = Vec3<double> { 0. };
+        auto reflected_color = Vec3<T> { 0 };
 
-            // Don't compute specular component if specular reflection is negligible
-            if (dot(record.m_material.ks, record.m_material.ks) > RAYTRACER_EPSILON)
-                specular = Raytracer::specular(
-                               light_direction,
-                               record.m_normal,
-                               E,
-                               1.,
-                               record.m_material.ior,
-                               record.m_material.m)
-                           * record.m_material.ks;
+        if (reflects(record.m_material)) {
+            RAYTRACER_STATS(Raytracer::Stats::count(Raytracer::Stats::ReflectionRays));
 
-            color += light->m_color * (record.m_material.ka + diffuse + specular);
+            reflected_color = record.m_material.km * compute_ray_color(get_reflection_ray(ray, record), Raytracer::Config::reflectivity_epsilon<T>, std::numeric_limits<T>::infinity(), depth + 1);
         }
 
-        auto reflection_ray = Ray(record.m_point, normalize(ray.get_direction() - 2. * dot(ray.get_direction(), record.m_normal) * record.m_normal));
-        auto reflected_color = record.m_material.km * compute_ray_color(reflection_ray, RAYTRACER_EPSILON, std::numeric_limits<double>::infinity(), depth + 1);
-
-        // Add color and reflected color; clamp to values between [0, 1].
-        color.for_each([&reflected_color](auto& v, auto idx) {
-            v = std::min(1., v + reflected_color[idx]);
-        });
-
-        return color;
+        return combine(color, reflected_color);
     }
 };
+
+using Scene = BasicScene<double>;
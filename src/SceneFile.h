@@ -0,0 +1,758 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <concepts>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "Camera.h"
+#include "Scene.h"
+#include "shapes/Group.h"
+#include "shapes/Instance.h"
+#include "shapes/Plane.h"
+#include "shapes/Sphere.h"
+#include "shapes/Torus.h"
+#include "shapes/Triangle.h"
+#include "shapes/TriangleMesh.h"
+#include "util/Binary.h"
+#include "util/Light.h"
+#include "util/MappedFile.h"
+#include "util/Material.h"
+#include "util/Mesh.h"
+#include "util/RayPacket.h"
+#include "util/Transform.h"
+#include "util/Vec.h"
+
+/**
+ * Scene files, and the binary caches compiled from them
+ *
+ * A scene file is plain text with one statement per line; # starts a comment. Vectors are three numbers,
+ * materials are referred to by name after they are defined, and mesh paths are relative to the scene file:
+ *
+ *     camera <eye> <look at> <up> <fov y> <focal distance> <width> <height>
+ *     light <position> <color> [<range>]
+ *     material <name> <ka> <kd> <ks> <km> <roughness> [<ior>]
+ *     sphere <center> <radius> <material>
+ *     plane <point> <normal> <material>
+ *     triangle <v0> <v1> <v2> <material>
+ *     torus <center> <major radius> <minor radius> <material>
+ *     mesh <path> <material> [smooth]
+ *     group <name>
+ *     end
+ *     instance <group> <position> <rotation axis> <rotation degrees> <scale> [<material>]
+ *
+ * The shapes between group and end make up a group instead of being added to the scene, and every instance
+ * places it, scaled, then rotated around its origin and moved to position. Planes can not be grouped, and
+ * groups are not nested.
+ *
+ * A cache holds the same scene after build(): its lights, materials, groups and shapes along with the BVH, the
+ * shape arrays, the BVH of every group and the faces and BVH of every mesh, as raw snapshots (see
+ * util/Binary.h). Loading one maps the file and copies the snapshots into place, with no parsing and nothing
+ * to build. It also records the size and modification time of the scene file and its meshes, and is only used
+ * while they are unchanged and by a build with the same precision and packet width.
+ */
+
+// What a scene file describes besides the scene itself
+template <std::floating_point T>
+struct BasicSceneDescription {
+    Vec3<T> m_eye;
+    Vec3<T> m_look_at;
+    Vec3<T> m_up;
+    T m_fov_y;
+    T m_focal_distance;
+    uint32_t m_width;
+    uint32_t m_height;
+
+    // The scene file and the meshes it loads
+    std::vector<std::string> m_files;
+
+    auto make_camera() const { return BasicCamera<T>(m_eye, m_look_at, m_up, m_fov_y, m_focal_distance, m_width, m_height); }
+};
+
+using SceneDescription = BasicSceneDescription<double>;
+
+namespace Raytracer {
+
+namespace SceneFile {
+    namespace Detail {
+        constexpr auto cache_magic = uint64_t { 0x45484341435452 }; // "RTCACHE"
+        constexpr auto cache_version = uint32_t { 3 };
+
+        enum class ShapeKind : uint8_t {
+            Sphere,
+            Plane,
+            Triangle,
+            Torus,
+            TriangleMesh,
+            Instance,
+        };
+
+        // Identifies the version of a file the cache was compiled from
+        struct Stamp {
+            uint64_t m_size;
+            int64_t m_modified; // Nanoseconds
+        };
+
+        bool inline get_stamp(std::string const& path, Stamp& stamp)
+        {
+            struct stat status;
+
+            if (::stat(path.c_str(), &status) != 0)
+                return false;
+
+            stamp = { static_cast<uint64_t>(status.st_size), status.st_mtim.tv_sec * 1'000'000'000ll + status.st_mtim.tv_nsec };
+
+            return true;
+        }
+
+        bool inline is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+        template <typename U>
+        bool parse(std::string_view token, U& value)
+        {
+            auto const [end, error] = std::from_chars(token.data(), token.data() + token.size(), value);
+
+            return error == std::errc {} && end == token.data() + token.size();
+        }
+
+        void inline write_header(Raytracer::Binary::Writer& writer, std::size_t scalar_size, std::size_t packet_width)
+        {
+            writer.write(cache_magic);
+            writer.write(cache_version);
+            writer.write(static_cast<uint32_t>(scalar_size));
+            writer.write(static_cast<uint32_t>(packet_width));
+        }
+
+        // Whether what follows was written by this build for the precision and packet width
+        bool inline read_header(Raytracer::Binary::Reader& reader, std::size_t scalar_size, std::size_t packet_width)
+        {
+            auto magic = uint64_t {};
+            auto version = uint32_t {};
+            auto written_scalar_size = uint32_t {};
+            auto written_packet_width = uint32_t {};
+
+            reader.read(magic);
+            reader.read(version);
+            reader.read(written_scalar_size);
+            reader.read(written_packet_width);
+
+            return reader.ok() && magic == cache_magic && version == cache_version && written_scalar_size == scalar_size && written_packet_width == packet_width;
+        }
+
+        // A shape after its material; instances refer to their group by its index in groups.
+        template <std::floating_point T>
+        bool write_shape(Raytracer::Binary::Writer& writer, BasicShape<T> const& shape, std::vector<BasicGroup<T> const*> const& groups)
+        {
+            auto const& type = typeid(shape);
+
+            writer.write(shape.get_material());
+
+            // Exact types only, like Scene::build()
+            if (type == typeid(BasicSphere<T>)) {
+                auto const& sphere = static_cast<BasicSphere<T> const&>(shape);
+
+                writer.write(ShapeKind::Sphere);
+                writer.write(sphere.get_center());
+                writer.write(sphere.get_radius());
+            } else if (type == typeid(BasicPlane<T>)) {
+                auto const& plane = static_cast<BasicPlane<T> const&>(shape);
+
+                writer.write(ShapeKind::Plane);
+                writer.write(plane.get_center());
+                writer.write(plane.get_normal());
+            } else if (type == typeid(BasicTriangle<T>)) {
+                auto const& triangle = static_cast<BasicTriangle<T> const&>(shape);
+
+                writer.write(ShapeKind::Triangle);
+                writer.write(triangle.get_v0());
+                writer.write(triangle.get_v1());
+                writer.write(triangle.get_v2());
+            } else if (type == typeid(BasicTorus<T>)) {
+                auto const& torus = static_cast<BasicTorus<T> const&>(shape);
+
+                writer.write(ShapeKind::Torus);
+                writer.write(torus.get_center());
+                writer.write(torus.get_major_radius());
+                writer.write(torus.get_minor_radius());
+            } else if (type == typeid(BasicTriangleMesh<T>)) {
+                writer.write(ShapeKind::TriangleMesh);
+                static_cast<BasicTriangleMesh<T> const&>(shape).write(writer);
+            } else if (type == typeid(BasicInstance<T>)) {
+                auto const& instance = static_cast<BasicInstance<T> const&>(shape);
+                auto const group = std::find(groups.begin(), groups.end(), instance.get_group().get());
+
+                if (group == groups.end())
+                    return false;
+
+                writer.write(ShapeKind::Instance);
+                writer.write(static_cast<uint32_t>(group - groups.begin()));
+                writer.write(instance.get_transform());
+            } else {
+                return false;
+            }
+
+            return true;
+        }
+
+        // A shape written by write_shape(), or null if it is not valid for the materials and groups
+        template <std::floating_point T>
+        std::shared_ptr<BasicShape<T>> read_shape(Raytracer::Binary::Reader& reader, std::size_t material_count, std::vector<std::shared_ptr<BasicGroup<T> const>> const& groups)
+        {
+            auto id = MaterialId {};
+            auto kind = ShapeKind {};
+            auto a = Vec3<T> {};
+            auto b = Vec3<T> {};
+            auto c = Vec3<T> {};
+            auto r = T {};
+            auto s = T {};
+
+            reader.read(id);
+            reader.read(kind);
+
+            if (!reader.ok() || (id >= material_count && !(kind == ShapeKind::Instance && id == BasicInstance<T>::group_materials)))
+                return nullptr;
+
+            switch (kind) {
+            case ShapeKind::Sphere:
+                reader.read(a);
+                reader.read(r);
+                return std::make_shared<BasicSphere<T>>(a, r, id);
+            case ShapeKind::Plane:
+                reader.read(a);
+                reader.read(b);
+                return std::make_shared<BasicPlane<T>>(a, b, id);
+            case ShapeKind::Triangle:
+                reader.read(a);
+                reader.read(b);
+                reader.read(c);
+                return std::make_shared<BasicTriangle<T>>(a, b, c, id);
+            case ShapeKind::Torus:
+                reader.read(a);
+                reader.read(r);
+                reader.read(s);
+                return std::make_shared<BasicTorus<T>>(a, r, s, id);
+            case ShapeKind::TriangleMesh: {
+                auto mesh = std::make_shared<BasicTriangleMesh<T>>(id);
+
+                return mesh->read(reader) ? mesh : nullptr;
+            }
+            case ShapeKind::Instance: {
+                auto group = uint32_t {};
+                auto transform = BasicTransform<T> {};
+
+                if (!reader.read(group) || !reader.read(transform) || group >= groups.size())
+                    return nullptr;
+
+                return std::make_shared<BasicInstance<T>>(groups[group], transform, id);
+            }
+            default:
+                return nullptr;
+            }
+        }
+
+        template <std::floating_point T>
+        bool write_body(Raytracer::Binary::Writer& writer, BasicScene<T> const& scene, BasicSceneDescription<T> const& description)
+        {
+            writer.write(description.m_eye);
+            writer.write(description.m_look_at);
+            writer.write(description.m_up);
+            writer.write(description.m_fov_y);
+            writer.write(description.m_focal_distance);
+            writer.write(description.m_width);
+            writer.write(description.m_height);
+
+            auto lights = std::vector<BasicLight<T>> {};
+
+            for (auto&& light : scene.get_lights())
+                lights.push_back(*light);
+
+            writer.write(lights);
+            writer.write(scene.get_materials());
+
+            // Every group once, in the order the instances first refer to them, before the instances
+            auto groups = std::vector<BasicGroup<T> const*> {};
+
+            for (auto&& shape : scene.get_shapes())
+                if (auto const* instance = dynamic_cast<BasicInstance<T> const*>(shape.get()))
+                    if (std::find(groups.begin(), groups.end(), instance->get_group().get()) == groups.end())
+                        groups.push_back(instance->get_group().get());
+
+            writer.write(static_cast<uint64_t>(groups.size()));
+
+            for (auto const* group : groups) {
+                writer.write(static_cast<uint64_t>(group->get_shapes().size()));
+
+                // Groups of instances are not stored
+                for (auto&& shape : group->get_shapes())
+                    if (!write_shape(writer, *shape, {}))
+                        return false;
+
+                group->write_build(writer);
+            }
+
+            writer.write(static_cast<uint64_t>(scene.get_shapes().size()));
+
+            for (auto&& shape : scene.get_shapes())
+                if (!write_shape(writer, *shape, groups))
+                    return false;
+
+            scene.write_build(writer);
+
+            return true;
+        }
+
+        template <std::floating_point T>
+        bool read_body(Raytracer::Binary::Reader& reader, BasicScene<T>& scene, BasicSceneDescription<T>& description)
+        {
+            reader.read(description.m_eye);
+            reader.read(description.m_look_at);
+            reader.read(description.m_up);
+            reader.read(description.m_fov_y);
+            reader.read(description.m_focal_distance);
+            reader.read(description.m_width);
+            reader.read(description.m_height);
+
+            auto lights = std::vector<BasicLight<T>> {};
+            auto materials = std::vector<BasicMaterial<T>> {};
+            auto group_count = uint64_t {};
+            auto shape_count = uint64_t {};
+
+            reader.read(lights);
+            reader.read(materials);
+            reader.read(group_count);
+
+            for (auto&& light : lights)
+                scene.add_light(std::make_shared<BasicLight<T>>(light));
+
+            for (auto&& material : materials)
+                scene.add_material(material);
+
+            auto groups = std::vector<std::shared_ptr<BasicGroup<T> const>> {};
+
+            for (auto i = 0uz; i < group_count && reader.ok(); i++) {
+                auto group = std::make_shared<BasicGroup<T>>();
+                auto count = uint64_t {};
+
+                reader.read(count);
+
+                for (auto j = 0uz; j < count && reader.ok(); j++) {
+                    auto shape = read_shape<T>(reader, materials.size(), {});
+
+                    if (!shape || !shape->get_bounding_box().is_bounded())
+                        return false;
+
+                    group->add_shape(std::move(shape));
+                }
+
+                if (!group->read_build(reader))
+                    return false;
+
+                groups.push_back(std::move(group));
+            }
+
+            reader.read(shape_count);
+
+            for (auto i = 0uz; i < shape_count && reader.ok(); i++) {
+                auto shape = read_shape(reader, materials.size(), groups);
+
+                if (!shape)
+                    return false;
+
+                scene.add_shape(std::move(shape));
+            }
+
+            return reader.ok() && scene.read_build(reader);
+        }
+    }
+
+    /**
+     * Parses a scene file into an empty scene and builds it
+     *
+     * Returns false if the file could not be read, a statement is malformed, a material is unknown or a mesh
+     * could not be loaded; error is then set to a message giving the line.
+     */
+    template <std::floating_point T>
+    bool load_text(std::string const& path, BasicScene<T>& scene, BasicSceneDescription<T>& description, std::string* error = nullptr)
+    {
+        using namespace Detail;
+
+        auto const file = MappedFile(path);
+
+        auto fail = [&](std::size_t line, std::string const& message) {
+            if (error)
+                *error = path + (line ? ":" + std::to_string(line) : "") + ": " + message;
+
+            return false;
+        };
+
+        if (!file.is_open())
+            return fail(0, "could not be read");
+
+        auto const text = file.get_contents();
+        auto const directory = std::filesystem::path(path).parent_path();
+
+        auto materials = std::unordered_map<std::string, MaterialId> {};
+        auto groups = std::unordered_map<std::string, std::shared_ptr<BasicGroup<T> const>> {};
+        auto tokens = std::vector<std::string_view> {};
+        auto has_camera = false;
+
+        // The group being defined, and the line of its group statement
+        auto group = std::shared_ptr<BasicGroup<T>> {};
+        auto group_name = std::string {};
+        auto group_line = 0uz;
+
+        auto add = [&](std::shared_ptr<BasicShape<T>> shape) {
+            if (group)
+                group->add_shape(std::move(shape));
+            else
+                scene.add_shape(std::move(shape));
+        };
+
+        description.m_files = { path };
+
+        for (auto position = 0uz, line = 1uz; position < text.size(); line++) {
+            auto end = text.find('\n', position);
+
+            if (end == std::string_view::npos)
+                end = text.size();
+
+            auto statement = text.substr(position, end - position);
+            position = end + 1;
+
+            statement = statement.substr(0, statement.find('#'));
+            tokens.clear();
+
+            for (auto i = 0uz; i < statement.size();) {
+                while (i < statement.size() && is_space(statement[i]))
+                    i++;
+
+                auto const first = i;
+
+                while (i < statement.size() && !is_space(statement[i]))
+                    i++;
+
+                if (i > first)
+                    tokens.push_back(statement.substr(first, i - first));
+            }
+
+            if (tokens.empty())
+                continue;
+
+            auto next = 1uz;
+            auto valid = true;
+
+            auto number = [&](auto& value) {
+                valid = valid && next < tokens.size() && parse(tokens[next++], value);
+            };
+
+            auto vector = [&](Vec3<T>& value) {
+                for (auto axis = 0uz; axis < 3; axis++)
+                    number(value[axis]);
+            };
+
+            auto unknown_material = std::string_view {};
+
+            auto material = [&](MaterialId& id) {
+                if (valid && next < tokens.size()) {
+                    auto const found = materials.find(std::string(tokens[next]));
+
+                    if (found != materials.end())
+                        id = found->second;
+                    else
+                        unknown_material = tokens[next];
+
+                    valid = found != materials.end();
+                    next++;
+                } else {
+                    valid = false;
+                }
+
+                return valid;
+            };
+
+            auto const keyword = tokens[0];
+            auto id = MaterialId {};
+
+            if (keyword == "camera") {
+                vector(description.m_eye);
+                vector(description.m_look_at);
+                vector(description.m_up);
+                number(description.m_fov_y);
+                number(description.m_focal_distance);
+                number(description.m_width);
+                number(description.m_height);
+                has_camera = true;
+            } else if (keyword == "light") {
+                auto light = BasicLight<T> {};
+
+                vector(light.m_position);
+                vector(light.m_color);
+
+                if (next < tokens.size())
+                    number(light.m_range);
+
+                scene.add_light(std::make_shared<BasicLight<T>>(light));
+            } else if (keyword == "material") {
+                auto value = BasicMaterial<T> {};
+                auto const name = next < tokens.size() ? std::string(tokens[next++]) : std::string();
+
+                vector(value.ka);
+                vector(value.kd);
+                vector(value.ks);
+                vector(value.km);
+                number(value.m);
+
+                if (next < tokens.size())
+                    number(value.ior);
+
+                if (valid)
+                    materials[name] = scene.add_material(value);
+            } else if (keyword == "sphere") {
+                auto center = Vec3<T> {};
+                auto radius = T {};
+
+                vector(center);
+                number(radius);
+
+                if (material(id))
+                    add(std::make_shared<BasicSphere<T>>(center, radius, id));
+            } else if (keyword == "plane") {
+                auto point = Vec3<T> {};
+                auto normal = Vec3<T> {};
+
+                vector(point);
+                vector(normal);
+
+                if (group)
+                    return fail(line, "planes can not be grouped");
+
+                if (material(id))
+                    scene.add_shape(std::make_shared<BasicPlane<T>>(point, normal, id));
+            } else if (keyword == "triangle") {
+                auto vertices = std::array<Vec3<T>, 3> {};
+
+                for (auto&& vertex : vertices)
+                    vector(vertex);
+
+                if (material(id))
+                    add(std::make_shared<BasicTriangle<T>>(vertices[0], vertices[1], vertices[2], id));
+            } else if (keyword == "torus") {
+                auto center = Vec3<T> {};
+                auto major_radius = T {};
+                auto minor_radius = T {};
+
+                vector(center);
+                number(major_radius);
+                number(minor_radius);
+
+                if (material(id))
+                    add(std::make_shared<BasicTorus<T>>(center, major_radius, minor_radius, id));
+            } else if (keyword == "mesh") {
+                auto const mesh_path = next < tokens.size() ? (directory / tokens[next++]).string() : std::string();
+                auto const smooth = material(id) && next < tokens.size() && tokens[next] == "smooth";
+                auto mesh = MeshData {};
+
+                next += smooth;
+
+                if (valid && next == tokens.size()) {
+                    if (!Raytracer::Mesh::load(mesh_path, mesh))
+                        return fail(line, "could not load mesh '" + mesh_path + "'");
+
+                    if (smooth && !mesh.has_normals())
+                        Raytracer::Mesh::compute_normals(mesh);
+
+                    description.m_files.push_back(mesh_path);
+                    add(std::make_shared<BasicTriangleMesh<T>>(std::move(mesh), id));
+                }
+            } else if (keyword == "group") {
+                if (group)
+                    return fail(line, "groups can not be nested");
+
+                group = std::make_shared<BasicGroup<T>>();
+                group_name = next < tokens.size() ? std::string(tokens[next++]) : std::string();
+                group_line = line;
+                valid = !group_name.empty();
+            } else if (keyword == "end") {
+                if (!group)
+                    return fail(line, "end without group");
+
+                if (group->get_shapes().empty())
+                    return fail(line, "empty group");
+
+                group->build();
+                groups[group_name] = std::move(group);
+            } else if (keyword == "instance") {
+                auto const found = next < tokens.size() ? groups.find(std::string(tokens[next++])) : groups.end();
+                auto position = Vec3<T> {};
+                auto axis = Vec3<T> {};
+                auto degrees = T {};
+                auto scale = T {};
+
+                if (group)
+                    return fail(line, "groups can not be nested");
+
+                if (found == groups.end())
+                    return fail(line, "unknown group");
+
+                vector(position);
+                vector(axis);
+                number(degrees);
+                number(scale);
+
+                id = BasicInstance<T>::group_materials;
+
+                if (next < tokens.size())
+                    material(id);
+
+                if (valid)
+                    add(std::make_shared<BasicInstance<T>>(
+                        found->second,
+                        BasicTransform<T>::translation(position) * BasicTransform<T>::rotation(axis, degrees) * BasicTransform<T>::scaling(Vec3<T>(scale)),
+                        id));
+            } else {
+                return fail(line, "unknown statement '" + std::string(keyword) + "'");
+            }
+
+            if (!unknown_material.empty())
+                return fail(line, "unknown material '" + std::string(unknown_material) + "'");
+
+            if (!valid || next != tokens.size())
+                return fail(line, "malformed " + std::string(keyword));
+        }
+
+        if (group)
+            return fail(group_line, "group without end");
+
+        if (!has_camera)
+            return fail(0, "no camera");
+
+        scene.build();
+
+        return true;
+    }
+
+    // Writes a built scene and its description as a cache; returns false for shapes of types it can not store.
+    template <std::floating_point T>
+    bool write_cache(std::string const& path, BasicScene<T> const& scene, BasicSceneDescription<T> const& description)
+    {
+        using namespace Detail;
+
+        auto writer = Raytracer::Binary::Writer {};
+
+        write_header(writer, sizeof(T), Raytracer::Packet::width<T>);
+        writer.write(static_cast<uint64_t>(description.m_files.size()));
+
+        for (auto&& file : description.m_files) {
+            auto stamp = Stamp {};
+
+            if (!get_stamp(file, stamp))
+                return false;
+
+            writer.write_string(file);
+            writer.write(stamp);
+        }
+
+        return write_body(writer, scene, description) && writer.save(path);
+    }
+
+    /**
+     * Loads a cache into an empty scene, ready to render
+     *
+     * Returns false if the cache could not be read, was written by a different build or is out of date with
+     * the files it was compiled from; the scene should then be discarded.
+     */
+    template <std::floating_point T>
+    bool load_cache(std::string const& path, BasicScene<T>& scene, BasicSceneDescription<T>& description)
+    {
+        using namespace Detail;
+
+        auto const file = MappedFile(path);
+
+        if (!file.is_open())
+            return false;
+
+        auto reader = Raytracer::Binary::Reader(file.get_contents());
+
+        if (!read_header(reader, sizeof(T), Raytracer::Packet::width<T>))
+            return false;
+
+        auto file_count = uint64_t {};
+
+        reader.read(file_count);
+        description.m_files.clear();
+
+        for (auto i = 0uz; i < file_count && reader.ok(); i++) {
+            auto name = std::string {};
+            auto stamp = Stamp {};
+            auto current = Stamp {};
+
+            reader.read_string(name);
+            reader.read(stamp);
+
+            if (!get_stamp(name, current) || current.m_size != stamp.m_size || current.m_modified != stamp.m_modified)
+                return false;
+
+            description.m_files.push_back(std::move(name));
+        }
+
+        return read_body(reader, scene, description) && reader.at_end();
+    }
+
+    /**
+     * A built scene and its description in the format of a cache, without the files they came from
+     *
+     * This is how a scene is handed to another process of the same build, e.g. a render worker (see
+     * Distributed.h). write_snapshot() returns false for shapes of types it can not store, read_snapshot() if
+     * the snapshot is not one of this build; the scene should then be discarded.
+     */
+    template <std::floating_point T>
+    bool write_snapshot(Raytracer::Binary::Writer& writer, BasicScene<T> const& scene, BasicSceneDescription<T> const& description)
+    {
+        Detail::write_header(writer, sizeof(T), Raytracer::Packet::width<T>);
+
+        return Detail::write_body(writer, scene, description);
+    }
+
+    template <std::floating_point T>
+    bool read_snapshot(Raytracer::Binary::Reader& reader, BasicScene<T>& scene, BasicSceneDescription<T>& description)
+    {
+        description.m_files.clear();
+
+        return Detail::read_header(reader, sizeof(T), Raytracer::Packet::width<T>) && Detail::read_body(reader, scene, description);
+    }
+
+    /**
+     * Loads a scene file through its cache, at the path of the scene file with .cache appended
+     *
+     * The cache is used if it is up to date; otherwise the scene file is parsed, built and the cache written
+     * for the next time. Returns false if the scene file could not be loaded, see load_text().
+     */
+    template <std::floating_point T>
+    bool load(std::string const& path, BasicScene<T>& scene, BasicSceneDescription<T>& description, std::string* error = nullptr)
+    {
+        auto const cache_path = path + ".cache";
+
+        if (load_cache(cache_path, scene, description))
+            return true;
+
+        scene = BasicScene<T> {};
+
+        if (!load_text(path, scene, description, error))
+            return false;
+
+        write_cache(cache_path, scene, description);
+
+        return true;
+    }
+}
+
+}
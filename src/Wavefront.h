@@ -0,0 +1,302 @@
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <vector>
+
+#include "Scene.h"
+#include "util/Config.h"
+#include "util/Ray.h"
+#include "util/RayPacket.h"
+#include "util/Record.h"
+#include "util/Stats.h"
+#include "util/Vec.h"
+
+// How the camera follows the rays of a pixel after its primary ray, see BasicCamera::set_pipeline()
+enum class Pipeline {
+    Recursive,       // Depth first, through Scene::compute_ray_color()
+    Wavefront,       // Breadth first, one bounce of a whole chunk at a time
+    SortedWavefront, // As above, with shadow rays grouped by light and reflection rays by direction
+};
+
+/**
+ * Breadth-first tracing of a batch of primary rays
+ *
+ * Instead of following every path depth first, the rays of a batch are traced one bounce at a time: the rays
+ * of a bounce are intersected as a stream, primary rays in packets, the hits are resolved, all of their shadow
+ * rays are tested together and the hits whose material reflects queue a reflection ray for the next bounce.
+ * Once the deepest bounce is done the colors are combined back up with Scene::combine(), so the arithmetic is
+ * the same as in Scene::shade() and so is the image.
+ *
+ * Sorting tests the shadow rays one light at a time and reflection rays in the order of their direction, so
+ * that consecutive rays visit the same parts of the BVH. The queues are kept between batches.
+ */
+template <std::floating_point T>
+class BasicWavefront {
+private:
+    using Ray = BasicRay<T>;
+    using Hit = BasicHit<T>;
+    using Scene = BasicScene<T>;
+    using LightSample = typename Scene::LightSample;
+
+    // A hit of some bounce, with what is needed to combine its color with that of its reflection ray
+    struct Entry {
+        BasicRecord<T> m_record;
+        Vec3<T> m_view;
+        Vec3<T> m_color;
+        Vec3<T> m_reflected_color;
+        uint32_t m_parent; // Entry the ray was reflected from, or the primary ray for the first bounce
+    };
+
+    // Rays of the current and the next bounce, each with the index of its parent
+    std::vector<Ray> m_rays;
+    std::vector<uint32_t> m_parents;
+    std::vector<Ray> m_next_rays;
+    std::vector<uint32_t> m_next_parents;
+    std::vector<Hit> m_hits;
+
+    // Entries of all bounces, the first entry of every bounce
+    std::vector<Entry> m_entries;
+    std::vector<std::size_t> m_bounces;
+
+    // Shadow rays of the entries of a bounce, one per light selected for every entry; the lights of entry i
+    // are [m_sample_offsets[i], m_sample_offsets[i + 1])
+    std::vector<LightSample> m_selected;
+    std::vector<LightSample> m_samples;
+    std::vector<std::size_t> m_sample_offsets;
+    std::vector<Ray> m_shadow_rays;
+    std::vector<T> m_light_times;
+    std::vector<uint8_t> m_occluded;
+
+    std::vector<uint32_t> m_order;
+    std::vector<uint32_t> m_keys;
+
+    bool m_sort;
+
+    // Closest hits of the rays of the bounce; shapes are Hit::miss for rays that hit nothing
+    void intersect(Scene const& scene, T min, [[maybe_unused]] bool packets)
+    {
+        m_hits.resize(m_rays.size());
+
+#ifndef DISABLE_RAY_PACKETS
+        if (packets) {
+            for (auto i = 0uz; i < m_rays.size(); i += Raytracer::Packet::width<T>) {
+                auto const lanes = std::min(Raytracer::Packet::width<T>, m_rays.size() - i);
+
+                auto packet = BasicRayPacket<T> {};
+                auto active = PacketMaskOf<T> {};
+                auto hit = BasicPacketHit<T> {
+                    .m_time = PacketOf<T> {} + std::numeric_limits<T>::infinity(),
+                    .m_shape = PacketIndexOf<T> {} + static_cast<Raytracer::Packet::Integer<T>>(Hit::miss),
+                    .m_element = PacketIndexOf<T> {}
+                };
+
+                for (auto lane = 0uz; lane < lanes; lane++) {
+                    packet.set_ray(lane, m_rays[i + lane]);
+                    active[lane] = -1;
+                }
+
+                auto const hits = scene.find_intersection(packet, active, min, hit);
+
+                for (auto lane = 0uz; lane < lanes; lane++)
+                    m_hits[i + lane] = {
+                        hit.m_time[lane],
+                        hits[lane] ? static_cast<uint32_t>(hit.m_shape[lane]) : Hit::miss,
+                        static_cast<uint32_t>(hit.m_element[lane])
+                    };
+            }
+
+            return;
+        }
+#endif
+
+        for (auto i = 0uz; i < m_rays.size(); i++)
+            if (!scene.find_intersection(m_rays[i], min, std::numeric_limits<T>::infinity(), m_hits[i]))
+                m_hits[i].m_shape = Hit::miss;
+    }
+
+    // Orders the rays of the bounce by direction, octant first, along a Morton curve
+    void sort_rays()
+    {
+        auto spread = [](uint32_t x) {
+            x = (x | (x << 16)) & 0x030000ff;
+            x = (x | (x << 8)) & 0x0300f00f;
+            x = (x | (x << 4)) & 0x030c30c3;
+            x = (x | (x << 2)) & 0x09249249;
+            return x;
+        };
+
+        auto quantize = [](T a) { return static_cast<uint32_t>(std::clamp((a + 1) * T { 511.5 }, T { 0 }, T { 1023 })); };
+
+        m_keys.resize(m_rays.size());
+        m_order.resize(m_rays.size());
+
+        for (auto i = 0uz; i < m_rays.size(); i++) {
+            auto const& direction = m_rays[i].get_direction();
+
+            m_keys[i] = (spread(quantize(direction.x)) << 2) | (spread(quantize(direction.y)) << 1) | spread(quantize(direction.z));
+        }
+
+        std::iota(m_order.begin(), m_order.end(), 0u);
+        std::sort(m_order.begin(), m_order.end(), [&](auto a, auto b) { return m_keys[a] < m_keys[b]; });
+
+        m_next_rays.clear();
+        m_next_parents.clear();
+
+        for (auto i : m_order) {
+            m_next_rays.push_back(m_rays[i]);
+            m_next_parents.push_back(m_parents[i]);
+        }
+
+        std::swap(m_rays, m_next_rays);
+        std::swap(m_parents, m_next_parents);
+    }
+
+    // Tests the shadow rays of the entries [first, m_entries.size()) and adds the light of the lights they see
+    void illuminate(Scene const& scene, std::size_t first)
+    {
+        auto const& lights = scene.get_lights();
+        auto const count = m_entries.size() - first;
+
+        // Lights of every entry, one after the other, as Scene::shade() would pick them
+        m_samples.clear();
+        m_sample_offsets.assign(1, 0);
+
+        for (auto entry = 0uz; entry < count; entry++) {
+            auto const& record = m_entries[first + entry].m_record;
+
+            scene.select_lights(record.m_point, record.m_normal, m_selected);
+            m_samples.insert(m_samples.end(), m_selected.begin(), m_selected.end());
+            m_sample_offsets.push_back(m_samples.size());
+        }
+
+        m_shadow_rays.clear();
+        m_light_times.resize(m_samples.size());
+        m_occluded.resize(m_samples.size());
+
+        for (auto entry = 0uz; entry < count; entry++)
+            for (auto i = m_sample_offsets[entry]; i < m_sample_offsets[entry + 1]; i++)
+                m_shadow_rays.push_back(scene.get_shadow_ray(m_entries[first + entry].m_record.m_point, *lights[m_samples[i].m_light], m_light_times[i]));
+
+        RAYTRACER_STATS(Raytracer::Stats::count(Raytracer::Stats::ShadowRays, m_shadow_rays.size()));
+
+        auto& occluders = scene.occluders();
+
+        auto test = [&](std::size_t i) {
+            m_occluded[i] = scene.is_occluded(m_shadow_rays[i], Raytracer::Config::epsilon<T>, m_light_times[i], occluders[m_samples[i].m_light]);
+        };
+
+        if (m_sort) {
+            m_order.resize(m_samples.size());
+            std::iota(m_order.begin(), m_order.end(), 0u);
+            std::stable_sort(m_order.begin(), m_order.end(), [&](auto a, auto b) { return m_samples[a].m_light < m_samples[b].m_light; });
+
+            for (auto i : m_order)
+                test(i);
+        } else {
+            for (auto i = 0uz; i < m_shadow_rays.size(); i++)
+                test(i);
+        }
+
+        for (auto entry = 0uz; entry < count; entry++) {
+            auto& hit = m_entries[first + entry];
+
+            for (auto i = m_sample_offsets[entry]; i < m_sample_offsets[entry + 1]; i++)
+                if (!m_occluded[i])
+                    hit.m_color += m_samples[i].m_weight * scene.illuminate(hit.m_record, hit.m_view, *lights[m_samples[i].m_light], m_shadow_rays[i].get_direction());
+        }
+    }
+
+public:
+    BasicWavefront()
+        : m_rays({})
+        , m_parents({})
+        , m_next_rays({})
+        , m_next_parents({})
+        , m_hits({})
+        , m_entries({})
+        , m_bounces({})
+        , m_selected({})
+        , m_samples({})
+        , m_sample_offsets({})
+        , m_shadow_rays({})
+        , m_light_times({})
+        , m_occluded({})
+        , m_order({})
+        , m_keys({})
+        , m_sort(false) {};
+
+    void set_sorting(bool sort) { m_sort = sort; }
+
+    // Colors of the primary rays, the same as Scene::compute_ray_color(ray, 0, infinity, 0) of each.
+    __attribute__((flatten)) void trace(Scene const& scene, std::span<Ray const> primary_rays, std::span<Vec3<T>> colors)
+    {
+        std::fill(colors.begin(), colors.end(), Vec3<T> { 0 });
+
+        m_rays.assign(primary_rays.begin(), primary_rays.end());
+        m_parents.resize(m_rays.size());
+        std::iota(m_parents.begin(), m_parents.end(), 0u);
+
+        m_entries.clear();
+        m_bounces.clear();
+
+        for (auto depth = 0; depth < RAYTRACER_MAX_RECURSION_DEPTH && !m_rays.empty(); depth++) {
+            if (m_sort && depth)
+                sort_rays();
+
+            intersect(scene, depth ? Raytracer::Config::reflectivity_epsilon<T> : T { 0 }, !depth);
+
+            auto const first = m_entries.size();
+            m_bounces.push_back(first);
+
+            m_next_rays.clear();
+            m_next_parents.clear();
+
+            for (auto i = 0uz; i < m_rays.size(); i++) {
+                RAYTRACER_STATS(Raytracer::Stats::reach_depth(depth));
+
+                if (m_hits[i].m_shape == Hit::miss)
+                    continue;
+
+                auto const& ray = m_rays[i];
+                auto const record = scene.resolve(ray, m_hits[i]);
+
+                // Rays at the maximum depth would return no color
+                if (Scene::reflects(record.m_material) && depth + 1 < RAYTRACER_MAX_RECURSION_DEPTH) {
+                    m_next_rays.push_back(scene.get_reflection_ray(ray, record));
+                    m_next_parents.push_back(m_entries.size());
+                }
+
+                m_entries.push_back({ record, normalize(ray.get_origin() - record.m_point), Vec3<T> { 0 }, Vec3<T> { 0 }, m_parents[i] });
+            }
+
+            RAYTRACER_STATS(Raytracer::Stats::count(Raytracer::Stats::ReflectionRays, m_next_rays.size()));
+
+            illuminate(scene, first);
+
+            std::swap(m_rays, m_next_rays);
+            std::swap(m_parents, m_next_parents);
+        }
+
+        // Deepest bounce first, so the reflected color of every entry is complete when it is combined
+        for (auto bounce = m_bounces.size(); bounce-- > 0;) {
+            auto const end = bounce + 1 < m_bounces.size() ? m_bounces[bounce + 1] : m_entries.size();
+
+            for (auto i = m_bounces[bounce]; i < end; i++) {
+                auto const& entry = m_entries[i];
+                auto const color = Scene::combine(entry.m_color, entry.m_reflected_color);
+
+                if (bounce)
+                    m_entries[entry.m_parent].m_reflected_color = m_entries[entry.m_parent].m_record.m_material.km * color;
+                else
+                    colors[entry.m_parent] = color;
+            }
+        }
+    }
+};
+
+using Wavefront = BasicWavefront<double>;
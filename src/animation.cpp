@@ -0,0 +1,77 @@
+#include "util/Image.h"
+
+#include "Animation.h"
+#include "Camera.h"
+#include "Scene.h"
+#include "SceneFile.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+/**
+ * Renders a turntable of a scene file
+ *
+ *   animation <scene> [<frames>]
+ *
+ * The camera circles the point it looks at once over the frames (60 by default), the first shape of the scene
+ * bounces up and down and the first light circles above the scene. Frames are written as frame_0000.png and on.
+ */
+
+int main(int argc, char** argv)
+{
+    using Clock = std::chrono::steady_clock;
+    using Vec3 = Vec3<double>;
+
+    if (argc < 2 || argc > 3) {
+        std::fprintf(stderr, "usage: %s <scene> [<frames>]\n", argv[0]);
+        return 1;
+    }
+
+    auto const frames = argc == 3 ? std::strtoul(argv[2], nullptr, 10) : 60ul;
+
+    auto scene = Scene();
+    auto description = SceneDescription {};
+    auto error = std::string {};
+
+    if (!Raytracer::SceneFile::load(argv[1], scene, description, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    auto camera = description.make_camera();
+    auto animation = Animation();
+
+    // One keyframe per frame for the circles, two per bounce
+    auto const center = description.m_look_at;
+    auto const arm = description.m_eye - center;
+
+    for (auto frame = 0uz; frame <= frames; frame++) {
+        auto const angle = 2. * M_PI * frame / frames;
+        auto const rotated = Vec3 { arm.x * std::cos(angle) + arm.z * std::sin(angle), arm.y, arm.z * std::cos(angle) - arm.x * std::sin(angle) };
+
+        animation.move_camera(frame, center + rotated, center, description.m_up);
+
+        if (!scene.get_lights().empty())
+            animation.move_light(0, frame, center + Vec3 { 4. * std::cos(angle), 4., 4. * std::sin(angle) });
+    }
+
+    if (!scene.get_shapes().empty())
+        for (auto bounce = 0uz; bounce <= 4; bounce++)
+            animation.move_shape(0, bounce * frames / 4., Vec3 { 0., bounce % 2 ? .5 : 0., 0. });
+
+    auto const start = Clock::now();
+
+    auto const ok = animation.render(scene, camera, 0, frames, 1., [&](std::size_t frame, auto const& pixels) {
+        char path[32];
+        std::snprintf(path, sizeof(path), "frame_%04zu.png", frame);
+
+        return Raytracer::Image::write_png(path, pixels, description.m_width, description.m_height);
+    });
+
+    std::printf("%lu frames in %.1f s\n", frames, std::chrono::duration<double>(Clock::now() - start).count());
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+#include "../util/Image.h"
+#include "../util/Vec.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Time to write a framebuffer with the ASCII P3 writer the example used to have against the writers of
+ * util/Image.h.
+ *
+ * The image is synthetic but render-like: smooth shading over a few flat regions with a little noise.
+ */
+
+namespace Legacy {
+    void write_p3(std::string const& path, std::vector<Vec3<uint8_t>> const& pixels, std::size_t width, std::size_t height)
+    {
+        auto out = std::ofstream(path);
+
+        out << "P3\n"
+            << width << ' ' << height << "\n255\n";
+
+        for (auto&& pixel : pixels)
+            out << (+pixel.x) << '\t' << (+pixel.y) << '\t' << (+pixel.z) << '\t';
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto const width = argc > 1 ? std::stoul(argv[1]) : 1024ul;
+    auto const height = argc > 2 ? std::stoul(argv[2]) : 768ul;
+    auto const repeats = 5;
+
+    auto rng = std::mt19937 { 0 };
+    auto noise = std::uniform_int_distribution<int>(-2, 2);
+    auto pixels = std::vector<Vec3<uint8_t>>(width * height);
+
+    for (auto j = 0ul; j < height; j++)
+        for (auto i = 0ul; i < width; i++) {
+            auto const x = static_cast<double>(i) / width - .5;
+            auto const y = static_cast<double>(j) / height - .5;
+            auto const inside = x * x + y * y < .1;
+            auto const shade = inside ? 200. * (1. - 4. * (x * x + y * y)) : 40. + 60. * y;
+
+            pixels[j * width + i] = Vec3<uint8_t> {
+                static_cast<uint8_t>(std::clamp(shade + noise(rng), 0., 255.)),
+                static_cast<uint8_t>(std::clamp(inside ? shade * .5 : shade, 0., 255.)),
+                static_cast<uint8_t>(std::clamp(inside ? 20. : shade + 30., 0., 255.)),
+            };
+        }
+
+    auto const directory = std::filesystem::temp_directory_path();
+
+    auto time = [&](char const* name, std::string const& file, auto&& write) {
+        auto const path = (directory / file).string();
+        auto best = std::numeric_limits<double>::infinity();
+
+        for (auto i = 0; i < repeats; i++) {
+            auto start = std::chrono::steady_clock::now();
+            write(path);
+            best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        std::printf("%-16s %9.2f ms %10ju bytes\n", name, best, static_cast<uintmax_t>(std::filesystem::file_size(path)));
+        std::filesystem::remove(path);
+
+        return best;
+    };
+
+    std::printf("%lu x %lu, best of %d, %u hardware threads\n", width, height, repeats, std::thread::hardware_concurrency());
+
+    auto const p3 = time("p3 (ascii)", "image_output.pbm", [&](auto const& path) { Legacy::write_p3(path, pixels, width, height); });
+    auto const p6 = time("p6", "image_output.ppm", [&](auto const& path) { Raytracer::Image::write_ppm(path, pixels, width, height); });
+    time("pfm", "image_output.pfm", [&](auto const& path) { Raytracer::Image::write_pfm<uint8_t>(path, pixels, width, height); });
+    time("png, 1 thread", "image_output.png", [&](auto const& path) { Raytracer::Image::write_png(path, pixels, width, height, 1); });
+    auto const png = time("png", "image_output.png", [&](auto const& path) { Raytracer::Image::write_png(path, pixels, width, height); });
+
+    std::printf("p3 / p6: %.1fx, p3 / png: %.1fx\n", p3 / p6, p3 / png);
+
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include "../shapes/Triangle.h"
+#include "../shapes/TriangleMesh.h"
+#include "../util/Mesh.h"
+#include "../util/Ray.h"
+#include "../util/Vec.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Load time and memory of a TriangleMesh against one Triangle shape per triangle.
+ *
+ * A UV sphere is written as OBJ and binary PLY, loaded back with the loaders of util/Mesh.h, and random rays
+ * are checked to hit the same triangles at the same times as with individual Triangle shapes.
+ */
+
+namespace {
+MeshData make_sphere(std::size_t rings, std::size_t segments)
+{
+    auto mesh = MeshData {};
+
+    for (auto i = 0uz; i <= rings; i++)
+        for (auto j = 0uz; j < segments; j++) {
+            auto const theta = M_PI * i / rings;
+            auto const phi = 2. * M_PI * j / segments;
+
+            mesh.add_vertex({ std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) });
+        }
+
+    for (auto i = 0uz; i < rings; i++)
+        for (auto j = 0uz; j < segments; j++) {
+            auto const a = static_cast<uint32_t>(i * segments + j);
+            auto const b = static_cast<uint32_t>(i * segments + (j + 1) % segments);
+            auto const c = static_cast<uint32_t>(a + segments);
+            auto const d = static_cast<uint32_t>(b + segments);
+
+            mesh.m_indices.insert(mesh.m_indices.end(), { a, b, c, b, d, c });
+        }
+
+    return mesh;
+}
+
+void write_obj(std::string const& path, MeshData const& mesh)
+{
+    auto out = std::ofstream(path);
+    char line[128];
+
+    for (auto i = 0uz; i < mesh.get_vertex_count(); i++)
+        out.write(line, std::snprintf(line, sizeof(line), "v %.9g %.9g %.9g\n", mesh.m_x[i], mesh.m_y[i], mesh.m_z[i]));
+
+    for (auto i = 0uz; i < mesh.m_indices.size(); i += 3)
+        out.write(line, std::snprintf(line, sizeof(line), "f %u %u %u\n", mesh.m_indices[i] + 1, mesh.m_indices[i + 1] + 1, mesh.m_indices[i + 2] + 1));
+}
+
+void write_ply(std::string const& path, MeshData const& mesh)
+{
+    auto out = std::ofstream(path, std::ios::binary);
+
+    out << "ply\nformat binary_little_endian 1.0\n"
+        << "element vertex " << mesh.get_vertex_count() << "\nproperty float x\nproperty float y\nproperty float z\n"
+        << "element face " << mesh.get_triangle_count() << "\nproperty list uchar int vertex_indices\nend_header\n";
+
+    for (auto i = 0uz; i < mesh.get_vertex_count(); i++) {
+        float const vertex[3] = { static_cast<float>(mesh.m_x[i]), static_cast<float>(mesh.m_y[i]), static_cast<float>(mesh.m_z[i]) };
+        out.write(reinterpret_cast<char const*>(vertex), sizeof(vertex));
+    }
+
+    for (auto i = 0uz; i < mesh.m_indices.size(); i += 3) {
+        auto const count = uint8_t { 3 };
+        out.write(reinterpret_cast<char const*>(&count), 1);
+        out.write(reinterpret_cast<char const*>(&mesh.m_indices[i]), 3 * sizeof(uint32_t));
+    }
+}
+
+double milliseconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+}
+
+int main(int argc, char** argv)
+{
+    auto const rings = argc > 1 ? std::stoul(argv[1]) : 500ul;
+    auto const segments = 2 * rings;
+
+    auto const sphere = make_sphere(rings, segments);
+    auto const directory = std::filesystem::temp_directory_path();
+    auto const obj_path = (directory / "mesh_loading.obj").string();
+    auto const ply_path = (directory / "mesh_loading.ply").string();
+
+    write_obj(obj_path, sphere);
+    write_ply(ply_path, sphere);
+
+    std::printf("%zu vertices, %zu triangles, %u hardware threads\n", sphere.get_vertex_count(), sphere.get_triangle_count(), std::thread::hardware_concurrency());
+
+    auto load = [&](char const* name, std::string const& path, auto&& loader) {
+        auto mesh = MeshData {};
+        auto const start = std::chrono::steady_clock::now();
+        auto const ok = loader(path, mesh);
+
+        std::printf("%-20s %9.1f ms %s (%ju bytes)\n", name, milliseconds_since(start), ok ? "" : "FAILED", static_cast<uintmax_t>(std::filesystem::file_size(path)));
+
+        return mesh;
+    };
+
+    load("obj, 1 thread", obj_path, [](auto const& path, auto& mesh) { return Raytracer::Mesh::load_obj(path, mesh, 1); });
+    auto const mesh = load("obj", obj_path, [](auto const& path, auto& mesh) { return Raytracer::Mesh::load_obj(path, mesh); });
+    load("ply", ply_path, [](auto const& path, auto& mesh) { return Raytracer::Mesh::load_ply(path, mesh); });
+
+    std::filesystem::remove(obj_path);
+    std::filesystem::remove(ply_path);
+
+    auto start = std::chrono::steady_clock::now();
+    auto const triangle_mesh = TriangleMesh(mesh, MaterialId {});
+    std::printf("%-20s %9.1f ms\n", "TriangleMesh", milliseconds_since(start));
+
+    start = std::chrono::steady_clock::now();
+    auto triangles = std::vector<std::shared_ptr<Triangle>> {};
+
+    for (auto i = 0uz; i < mesh.m_indices.size(); i += 3)
+        triangles.push_back(std::make_shared<Triangle>(
+            mesh.get_vertex(mesh.m_indices[i]),
+            mesh.get_vertex(mesh.m_indices[i + 1]),
+            mesh.get_vertex(mesh.m_indices[i + 2]),
+            MaterialId {}));
+
+    std::printf("%-20s %9.1f ms\n", "shared_ptr<Triangle>", milliseconds_since(start));
+
+    // Vertex and index buffers, precomputed faces and the BVH nodes; against the Triangle objects with their
+    // shared_ptr control blocks (two pointers and two counters) and the pointers themselves
+    auto const mesh_bytes = 3 * sizeof(double) * mesh.get_vertex_count()
+                            + sizeof(uint32_t) * mesh.m_indices.size()
+                            + 3 * sizeof(Vec3<double>) * mesh.get_triangle_count()
+                            + sizeof(BVH::Node) * 2 * mesh.get_triangle_count() / RAYTRACER_BVH_MAX_LEAF_SIZE;
+    auto const triangle_bytes = (sizeof(Triangle) + 2 * sizeof(void*) + 2 * sizeof(int) + sizeof(std::shared_ptr<Triangle>)) * triangles.size();
+
+    std::printf("memory: mesh ~%.1f MB, triangles ~%.1f MB without a scene BVH\n", mesh_bytes / 1e6, triangle_bytes / 1e6);
+
+    // Same closest hits as brute force over the individual triangles
+    auto rng = std::mt19937 { 0 };
+    auto uniform = std::uniform_real_distribution<double>(-1., 1.);
+    auto mismatches = 0;
+    auto const infinity = std::numeric_limits<double>::infinity();
+
+    for (auto i = 0; i < 100; i++) {
+        auto const origin = Vec3<double> { 3. * uniform(rng), 3. * uniform(rng), 3. };
+        auto const ray = Ray(origin, normalize(Vec3<double> { .5 * uniform(rng), .5 * uniform(rng), 0. } - origin));
+
+        auto element = 0u;
+        auto const time = triangle_mesh.find_intersection(ray, 0., infinity, element);
+
+        auto closest = infinity;
+        auto closest_element = 0u;
+
+        for (auto j = 0u; j < triangles.size(); j++) {
+            auto const t = triangles[j]->find_intersection(ray, 0., closest);
+
+            if (t > 0. && t < closest) {
+                closest = t;
+                closest_element = j;
+            }
+        }
+
+        mismatches += time != closest || (time < infinity && element != closest_element);
+    }
+
+    std::printf("mismatches against brute force: %d / 100\n", mismatches);
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include "../Camera.h"
+#include "../Scene.h"
+#include "../shapes/Plane.h"
+#include "../shapes/Sphere.h"
+#include "../shapes/Torus.h"
+#include "../shapes/Triangle.h"
+#include "../util/Vec.h"
+
+#include <algorithm>
+#include <chrono>
+#include <concepts>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Rendering throughput in double and single precision.
+ *
+ * The same scene of random spheres and triangles over a plane, with a mirror sphere and a torus, is built with
+ * BasicScene<double> and BasicScene<float>. Closest hits of the primary rays are timed on one thread, as packets
+ * and one ray at a time, then whole frames are rendered and the single precision image is compared against the
+ * double precision one.
+ */
+
+namespace {
+template <std::floating_point T>
+void build_scene(BasicScene<T>& scene, std::size_t count)
+{
+    using Vec3 = Vec3<T>;
+
+    auto rng = std::mt19937 { 0 };
+    auto uniform = std::uniform_real_distribution<double>(0., 1.);
+    auto random = [&](double min, double max) { return static_cast<T>(min + (max - min) * uniform(rng)); };
+
+    scene.add_light(std::make_shared<BasicLight<T>>(Vec3 { 0, 8, 4 }, Vec3 { T { .5 } }));
+    scene.add_light(std::make_shared<BasicLight<T>>(Vec3 { -6, 4, 8 }, Vec3 { T { .4 } }));
+
+    auto material = [&](T reflectivity) {
+        return scene.add_material(BasicMaterial<T> {
+            Vec3 { T { .1 } },
+            Vec3 { random(.2, 1.), random(.2, 1.), random(.2, 1.) },
+            Vec3 { T { .5 } },
+            Vec3 { reflectivity },
+            T { .3 },
+            T { 2.5 } });
+    };
+
+    for (auto i = 0uz; i < count; i++) {
+        auto const center = Vec3 { random(-6., 6.), random(-2., 4.), random(-12., 0.) };
+
+        if (i % 2)
+            scene.add_shape(std::make_shared<BasicSphere<T>>(center, random(.05, .2), material(T { 0 })));
+        else
+            scene.add_shape(std::make_shared<BasicTriangle<T>>(
+                center,
+                center + Vec3 { random(-.3, .3), random(-.3, .3), random(-.3, .3) },
+                center + Vec3 { random(-.3, .3), random(-.3, .3), random(-.3, .3) },
+                material(T { 0 })));
+    }
+
+    scene.add_shape(std::make_shared<BasicSphere<T>>(Vec3 { 0, 0, -4 }, T { 1.5 }, material(T { .8 })));
+    scene.add_shape(std::make_shared<BasicTorus<T>>(Vec3 { 3, 1, -2 }, T { .8 }, T { .2 }, material(T { .2 })));
+    scene.add_shape(std::make_shared<BasicPlane<T>>(Vec3 { 0, -3, 0 }, Vec3 { 0, 1, 0 }, material(T { .3 })));
+
+    scene.build();
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Closest-hit queries for the primary rays, in packets and one at a time, then full renders; returns the image
+template <std::floating_point T>
+std::vector<Vec3<uint8_t>> run(char const* name, std::size_t count, std::size_t width, std::size_t height, int repeats)
+{
+    auto scene = BasicScene<T>();
+    build_scene(scene, count);
+
+    auto camera = BasicCamera<T>(Vec3<T> { 0, 1, 6 }, Vec3<T> { 0, 0, -4 }, Vec3<T> { 0, 1, 0 }, 60., 1., width, height);
+    auto const rays = static_cast<double>(width * height);
+    auto hits = 0uz;
+
+    auto packet_time = std::numeric_limits<double>::infinity();
+    auto single_time = std::numeric_limits<double>::infinity();
+    auto render_time = std::numeric_limits<double>::infinity();
+
+    for (auto repeat = 0; repeat < repeats; repeat++) {
+        auto start = std::chrono::steady_clock::now();
+
+        for (auto i = 0uz; i < width; i++)
+            for (auto j = 0uz; j < height; j += Raytracer::Packet::width<T>) {
+                auto packet = BasicRayPacket<T> {};
+                auto active = PacketMaskOf<T> {};
+                auto hit = BasicPacketHit<T> { .m_time = PacketOf<T> {} + std::numeric_limits<T>::infinity() };
+
+                for (auto lane = 0uz; lane < std::min(Raytracer::Packet::width<T>, height - j); lane++) {
+                    packet.set_ray(lane, camera.get_primary_ray(.5 + i, .5 + j + lane));
+                    active[lane] = -1;
+                }
+
+                auto const mask = scene.find_intersection(packet, active, 0, hit);
+
+                for (auto lane = 0uz; lane < Raytracer::Packet::width<T>; lane++)
+                    hits += mask[lane] != 0;
+            }
+
+        packet_time = std::min(packet_time, seconds_since(start));
+        start = std::chrono::steady_clock::now();
+
+        for (auto i = 0uz; i < width; i++)
+            for (auto j = 0uz; j < height; j++) {
+                auto hit = BasicHit<T> {};
+                hits += scene.find_intersection(camera.get_primary_ray(.5 + i, .5 + j), 0, std::numeric_limits<T>::infinity(), hit);
+            }
+
+        single_time = std::min(single_time, seconds_since(start));
+    }
+
+    for (auto repeat = 0; repeat < repeats; repeat++) {
+        auto const start = std::chrono::steady_clock::now();
+        camera.render(scene);
+        render_time = std::min(render_time, seconds_since(start));
+    }
+
+    std::printf(
+        "%-8s %5zu %9.1f %% %12.2f %12.2f %12.1f\n",
+        name,
+        Raytracer::Packet::width<T>,
+        100. * hits / (2 * repeats * rays),
+        rays / packet_time / 1e6,
+        rays / single_time / 1e6,
+        1e3 * render_time);
+
+    return camera.take_pixels();
+}
+}
+
+int main(int argc, char** argv)
+{
+    auto const count = argc > 1 ? std::stoul(argv[1]) : 20000ul;
+    auto const width = argc > 2 ? std::stoul(argv[2]) : 800ul;
+    auto const height = argc > 3 ? std::stoul(argv[3]) : 600ul;
+    auto const repeats = 3;
+
+    std::printf("%zu shapes, %zu x %zu pixels, best of %d\n", count + 3, width, height, repeats);
+    std::printf("%-8s %5s %11s %12s %12s %12s\n", "", "lanes", "hits", "packets", "single rays", "render");
+    std::printf("%-8s %5s %11s %12s %12s %12s\n", "", "", "", "(Mrays/s)", "(Mrays/s)", "(ms)");
+
+    auto const reference = run<double>("double", count, width, height, repeats);
+    auto const pixels = run<float>("float", count, width, height, repeats);
+
+    // Differences come from shapes seen edge on and from the shadow and reflection rays that follow them
+    auto differing = 0uz;
+    auto large = 0uz;
+
+    for (auto i = 0uz; i < pixels.size(); i++) {
+        auto difference = 0;
+
+        for (auto channel = 0uz; channel < 3; channel++)
+            difference = std::max(difference, std::abs(pixels[i][channel] - reference[i][channel]));
+
+        differing += difference > 0;
+        large += difference > 8;
+    }
+
+    std::printf("float against double: %zu pixels differ, %zu by more than 8 / 255\n", differing, large);
+
+    return 0;
+}
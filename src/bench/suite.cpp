@@ -0,0 +1,538 @@
+#include "../Camera.h"
+#include "../Scene.h"
+#include "../shapes/Plane.h"
+#include "../shapes/Sphere.h"
+#include "../shapes/Torus.h"
+#include "../shapes/Triangle.h"
+#include "../util/BoundingBox.h"
+#include "../util/Lighting.h"
+#include "../util/Ray.h"
+#include "../util/Vec.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <concepts>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * Benchmark suite for regression tracking
+ *
+ *   suite [--json=<path>] [--quick] [--width=<pixels>] [--height=<pixels>] [--pipeline=recursive|wavefront|sorted]
+ *
+ * - Primitives: rays per second through find_intersection() of Sphere, Plane, Triangle and Torus and through
+ *   the slab test of BoundingBox, in double and single precision. Rays start around the shape and are aimed
+ *   at random points of its bounds, so that most of them reach the expensive part of the test.
+ * - Shading: calls per second of Raytracer::specular() for random light, normal and view directions.
+ * - Scenes: random spheres, triangle soups and grids of tori of several sizes over a ground plane, lit by two
+ *   lights, rendered end to end with one sample per pixel for each thread count. Throughput is in primary
+ *   rays, i.e. pixels, per second; shadow and reflection rays are part of the cost of a pixel.
+ * - Tiling: the largest sphere scene on every hardware thread with each tile order and several tile sizes,
+ *   with the last level cache misses of the render per primary ray where the kernel lets the process count
+ *   them (perf_event_open(); "n/a" otherwise, e.g. in most virtual machines).
+ *
+ * A table is printed as results come in; --json also writes them to a file for comparison between
+ * releases. --quick leaves out the largest scenes, --pipeline selects how the scenes are rendered.
+ */
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+struct Options {
+    char const* m_json = nullptr;
+    bool m_quick = false;
+    std::size_t m_width = 320;
+    std::size_t m_height = 240;
+    Pipeline m_pipeline = Pipeline::Recursive;
+    char const* m_pipeline_name = "recursive";
+};
+
+struct PrimitiveResult {
+    std::string m_name;
+    char const* m_precision;
+    double m_rays_per_second;
+    double m_hit_rate;
+};
+
+struct ShadingResult {
+    std::string m_name;
+    char const* m_precision;
+    double m_calls_per_second;
+};
+
+struct SceneResult {
+    char const* m_scene;
+    char const* m_precision;
+    std::size_t m_shapes;
+    std::size_t m_threads;
+    double m_build_ms;
+    double m_render_ms;
+    double m_mrays_per_second;
+};
+
+struct TilingResult {
+    char const* m_order;
+    std::size_t m_size;
+    double m_render_ms;
+    double m_mrays_per_second;
+    double m_cache_misses_per_ray; // Negative if they could not be counted
+};
+
+struct Results {
+    std::vector<PrimitiveResult> m_primitives;
+    std::vector<ShadingResult> m_shading;
+    std::vector<SceneResult> m_scenes;
+    std::vector<TilingResult> m_tiling;
+};
+
+template <std::floating_point T>
+constexpr char const* precision_name = std::is_same_v<T, float> ? "float" : "double";
+
+// Keeps the compiler from dropping a computation whose result is otherwise unused
+template <typename T>
+void keep(T const& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Last level cache misses of this thread and of the threads it starts while counting, if the kernel allows it
+class CacheMisses {
+private:
+    int m_fd;
+
+public:
+    CacheMisses()
+    {
+        auto attributes = perf_event_attr {};
+        attributes.size = sizeof(attributes);
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+        attributes.disabled = 1;
+        attributes.inherit = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+
+        m_fd = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+    }
+
+    ~CacheMisses()
+    {
+        if (m_fd >= 0)
+            close(m_fd);
+    }
+
+    CacheMisses(CacheMisses const&) = delete;
+    CacheMisses& operator=(CacheMisses const&) = delete;
+
+    bool available() const { return m_fd >= 0; }
+
+    // Counts while run() runs; the threads it starts must have exited when it returns.
+    uint64_t count(auto&& run)
+    {
+        auto misses = uint64_t {};
+
+        ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+        run();
+        ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+
+        return read(m_fd, &misses, sizeof(misses)) == sizeof(misses) ? misses : 0;
+    }
+};
+
+// Calls run(i) for i = 0, 1, ... until at least a quarter of a second has passed; returns calls per second.
+double measure(std::size_t batch, auto&& run)
+{
+    auto calls = 0uz;
+    auto const start = Clock::now();
+
+    do {
+        for (auto i = 0uz; i < batch; i++)
+            run(i);
+
+        calls += batch;
+    } while (seconds_since(start) < .25);
+
+    return calls / seconds_since(start);
+}
+
+template <std::floating_point T>
+void bench_primitives(Results& results)
+{
+    using Vec3 = Vec3<T>;
+
+    auto rng = std::mt19937 { 0 };
+    auto uniform = std::uniform_real_distribution<double>(-1., 1.);
+    auto random = [&](double scale) { return static_cast<T>(scale * uniform(rng)); };
+
+    auto const infinity = std::numeric_limits<T>::infinity();
+    auto const count = 1uz << 16;
+
+    // Rays from a shell around the origin towards points of the box [-extent, extent]
+    auto make_rays = [&](Vec3 const& extent) {
+        auto rays = std::vector<BasicRay<T>> {};
+        rays.reserve(count);
+
+        for (auto i = 0uz; i < count; i++) {
+            auto const origin = T { 4 } * normalize(Vec3 { random(1.), random(1.), random(1.) });
+            auto const target = Vec3 { random(extent.x), random(extent.y), random(extent.z) };
+
+            rays.push_back(BasicRay<T>(origin, normalize(target - origin)));
+        }
+
+        return rays;
+    };
+
+    auto run = [&](std::string const& name, Vec3 const& extent, auto&& intersect) {
+        auto const rays = make_rays(extent);
+        auto hits = 0uz;
+
+        for (auto&& ray : rays)
+            hits += intersect(ray);
+
+        auto const rays_per_second = measure(count, [&](std::size_t i) { keep(intersect(rays[i])); });
+
+        results.m_primitives.push_back({ name, precision_name<T>, rays_per_second, static_cast<double>(hits) / count });
+
+        std::printf("%-36s %-6s %10.2f Mrays/s %5.1f %% hits\n", name.c_str(), precision_name<T>, rays_per_second / 1e6, 100. * hits / count);
+    };
+
+    auto const sphere = BasicSphere<T>(Vec3 { 0 }, T { 1 }, MaterialId {});
+    auto const plane = BasicPlane<T>(Vec3 { 0 }, normalize(Vec3 { 1, 2, 3 }), MaterialId {});
+    auto const triangle = BasicTriangle<T>(Vec3 { -1, -1, 0 }, Vec3 { 1, -1, 0 }, Vec3 { 0, 1, 0 }, MaterialId {});
+    auto const torus = BasicTorus<T>(Vec3 { 0 }, T { .8 }, T { .2 }, MaterialId {});
+    auto const box = BasicBoundingBox<T>(Vec3 { -1 }, Vec3 { 1 });
+
+    auto hit = [&](T time) { return time > 0 && time < infinity; };
+
+    run("Sphere::find_intersection", Vec3 { 1 }, [&](auto const& ray) { return hit(sphere.find_intersection(ray, 0, infinity)); });
+    run("Plane::find_intersection", Vec3 { 1 }, [&](auto const& ray) { return hit(plane.find_intersection(ray, 0, infinity)); });
+    run("Triangle::find_intersection", Vec3 { 1, 1, 0 }, [&](auto const& ray) { return hit(triangle.find_intersection(ray, 0, infinity)); });
+    run("Torus::find_intersection", Vec3 { 1, 1, .2 }, [&](auto const& ray) { return hit(torus.find_intersection(ray, 0, infinity)); });
+    run("BoundingBox::find_intersection", Vec3 { 1.5 }, [&](auto const& ray) {
+        return box.find_intersection(ray, T { 1 } / ray.get_direction(), 0, infinity);
+    });
+}
+
+template <std::floating_point T>
+void bench_shading(Results& results)
+{
+    using Vec3 = Vec3<T>;
+
+    auto rng = std::mt19937 { 0 };
+    auto uniform = std::uniform_real_distribution<double>(-1., 1.);
+    auto random_direction = [&]() {
+        return normalize(Vec3 { static_cast<T>(uniform(rng)), static_cast<T>(uniform(rng)), static_cast<T>(uniform(rng)) });
+    };
+
+    // Light and view directions in the hemisphere of the normal, as they are when specular() is called
+    struct Sample {
+        Vec3 m_light;
+        Vec3 m_normal;
+        Vec3 m_view;
+    };
+
+    auto samples = std::vector<Sample>(1uz << 12);
+
+    for (auto&& sample : samples) {
+        sample.m_normal = random_direction();
+
+        for (auto* direction : { &sample.m_light, &sample.m_view }) {
+            *direction = random_direction();
+
+            if (dot(*direction, sample.m_normal) < 0)
+                *direction *= T { -1 };
+        }
+    }
+
+    auto const calls_per_second = measure(samples.size(), [&](std::size_t i) {
+        keep(Raytracer::specular(samples[i].m_light, samples[i].m_normal, samples[i].m_view, T { 1 }, T { 2.5 }, T { .3 }));
+    });
+
+    results.m_shading.push_back({ "Raytracer::specular", precision_name<T>, calls_per_second });
+
+    std::printf("%-36s %-6s %10.2f Mcalls/s\n", "Raytracer::specular", precision_name<T>, calls_per_second / 1e6);
+}
+
+// Shapes spread over a box in front of the camera, sized so that scenes of any count cover the view about as much
+template <std::floating_point T>
+void make_scene(BasicScene<T>& scene, char const* kind, std::size_t count)
+{
+    using Vec3 = Vec3<T>;
+
+    auto rng = std::mt19937 { 0 };
+    auto uniform = std::uniform_real_distribution<double>(-1., 1.);
+    auto random = [&](double scale) { return static_cast<T>(scale * uniform(rng)); };
+
+    scene.add_light(std::make_shared<BasicLight<T>>(Vec3 { 0, 10, 5 }, Vec3 { T { .5 } }));
+    scene.add_light(std::make_shared<BasicLight<T>>(Vec3 { -8, 4, 10 }, Vec3 { T { .4 } }));
+
+    auto const diffuse = scene.add_material(BasicMaterial<T> { Vec3 { T { .1 } }, Vec3 { T { .8 } }, Vec3 { T { .5 } }, Vec3 { 0 }, T { .3 }, T { 2.5 } });
+    auto const glossy = scene.add_material(BasicMaterial<T> { Vec3 { T { .1 } }, Vec3 { T { .4 } }, Vec3 { 1 }, Vec3 { T { .3 } }, T { .2 }, T { 2.5 } });
+
+    auto const size = static_cast<T>(2.5 / std::cbrt(static_cast<double>(count)));
+    auto center = [&]() { return Vec3 { random(5.), random(4.), random(5.) - 10 }; };
+
+    if (!std::strcmp(kind, "spheres")) {
+        for (auto i = 0uz; i < count; i++)
+            scene.add_shape(std::make_shared<BasicSphere<T>>(center(), size * static_cast<T>(.5 + .25 * uniform(rng)), i % 4 ? diffuse : glossy));
+    } else if (!std::strcmp(kind, "triangles")) {
+        for (auto i = 0uz; i < count; i++) {
+            auto const v0 = center();
+
+            scene.add_shape(std::make_shared<BasicTriangle<T>>(
+                v0,
+                v0 + Vec3 { random(size), random(size), random(size) },
+                v0 + Vec3 { random(size), random(size), random(size) },
+                i % 4 ? diffuse : glossy));
+        }
+    } else {
+        // A square grid of tori facing the camera
+        auto const side = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+        auto const spacing = T { 10 } / side;
+
+        for (auto i = 0uz; i < count; i++)
+            scene.add_shape(std::make_shared<BasicTorus<T>>(
+                Vec3 { (i % side + T { .5 }) * spacing - 5, (i / side + T { .5 }) * spacing - 4, -10 },
+                T { .35 } * spacing,
+                T { .1 } * spacing,
+                i % 4 ? diffuse : glossy));
+    }
+
+    scene.add_shape(std::make_shared<BasicPlane<T>>(Vec3 { 0, -5, 0 }, Vec3 { 0, 1, 0 }, diffuse));
+}
+
+template <std::floating_point T>
+void bench_scene(Results& results, Options const& options, char const* kind, std::size_t count, std::vector<std::size_t> const& thread_counts)
+{
+    auto scene = BasicScene<T>();
+    make_scene(scene, kind, count);
+
+    auto const start = Clock::now();
+    scene.build();
+    auto const build_ms = 1e3 * seconds_since(start);
+
+    auto camera = BasicCamera<T>(Vec3<T> { 0, 0, 6 }, Vec3<T> { 0, 0, -10 }, Vec3<T> { 0, 1, 0 }, 50., 1., options.m_width, options.m_height);
+    camera.set_pipeline(options.m_pipeline);
+
+    for (auto threads : thread_counts) {
+        auto best = std::numeric_limits<double>::infinity();
+
+        for (auto repeat = 0; repeat < 2; repeat++) {
+            auto const start = Clock::now();
+            camera.render(scene, threads);
+            best = std::min(best, seconds_since(start));
+        }
+
+        auto const mrays = options.m_width * options.m_height / best / 1e6;
+
+        results.m_scenes.push_back({ kind, precision_name<T>, count, threads, build_ms, 1e3 * best, mrays });
+
+        std::printf("%-10s %7zu shapes %-6s %2zu threads %9.1f ms build %9.1f ms render %8.3f Mrays/s\n",
+                    kind, count, precision_name<T>, threads, build_ms, 1e3 * best, mrays);
+    }
+}
+
+// Tile orders and sizes on every hardware thread; the scene is the same for all of them.
+void bench_tiling(Results& results, Options const& options, std::size_t count, std::size_t threads)
+{
+    auto scene = Scene();
+    make_scene(scene, "spheres", count);
+    scene.build();
+
+    auto camera = Camera(Vec3<double> { 0, 0, 6 }, Vec3<double> { 0, 0, -10 }, Vec3<double> { 0, 1, 0 }, 50., 1., options.m_width, options.m_height);
+    camera.set_pipeline(options.m_pipeline);
+
+    struct Order {
+        char const* m_name;
+        TileOrder m_order;
+    };
+
+    auto const orders = { Order { "columns", TileOrder::Columns }, Order { "morton", TileOrder::Morton }, Order { "hilbert", TileOrder::Hilbert }, Order { "spiral", TileOrder::Spiral } };
+    auto misses = CacheMisses();
+
+    for (auto&& order : orders)
+        for (auto size : { 16uz, 32uz, 48uz, 64uz, 128uz }) {
+            camera.set_tiling({ size, order.m_order });
+
+            auto best = std::numeric_limits<double>::infinity();
+            auto fewest = std::numeric_limits<uint64_t>::max();
+
+            for (auto repeat = 0; repeat < 2; repeat++) {
+                auto const start = Clock::now();
+
+                if (misses.available())
+                    fewest = std::min(fewest, misses.count([&]() { camera.render(scene, threads); }));
+                else
+                    camera.render(scene, threads);
+
+                best = std::min(best, seconds_since(start));
+            }
+
+            auto const pixels = static_cast<double>(options.m_width * options.m_height);
+            auto const mrays = pixels / best / 1e6;
+            auto const misses_per_ray = misses.available() ? fewest / pixels : -1.;
+
+            results.m_tiling.push_back({ order.m_name, size, 1e3 * best, mrays, misses_per_ray });
+
+            std::printf("tiling     %7zu shapes %-8s %3zu px %2zu threads %9.1f ms render %8.3f Mrays/s ", count, order.m_name, size, threads, 1e3 * best, mrays);
+
+            if (misses.available())
+                std::printf("%9.2f misses/ray\n", misses_per_ray);
+            else
+                std::printf("%9s misses/ray\n", "n/a");
+        }
+}
+
+void write_json(Results const& results, Options const& options, std::vector<std::size_t> const& thread_counts)
+{
+    auto* file = std::fopen(options.m_json, "w");
+
+    if (!file) {
+        std::fprintf(stderr, "Could not open %s\n", options.m_json);
+        return;
+    }
+
+    std::fprintf(file, "{\n  \"machine\": {\n");
+    std::fprintf(file, "    \"compiler\": \"%s\",\n", __VERSION__);
+    std::fprintf(file, "    \"hardware_threads\": %u,\n", std::thread::hardware_concurrency());
+    std::fprintf(file, "    \"packet_width\": %zu,\n", Raytracer::Packet::width<double>);
+    std::fprintf(file, "    \"timestamp\": %lld\n  },\n", static_cast<long long>(std::time(nullptr)));
+
+    std::fprintf(file, "  \"image\": { \"width\": %zu, \"height\": %zu, \"pipeline\": \"%s\" },\n", options.m_width, options.m_height, options.m_pipeline_name);
+
+    std::fprintf(file, "  \"thread_counts\": [");
+    for (auto i = 0uz; i < thread_counts.size(); i++)
+        std::fprintf(file, "%s%zu", i ? ", " : "", thread_counts[i]);
+    std::fprintf(file, "],\n");
+
+    std::fprintf(file, "  \"primitives\": [\n");
+    for (auto i = 0uz; i < results.m_primitives.size(); i++) {
+        auto const& result = results.m_primitives[i];
+
+        std::fprintf(file, "    { \"name\": \"%s\", \"precision\": \"%s\", \"rays_per_second\": %.6g, \"hit_rate\": %.4f }%s\n",
+                     result.m_name.c_str(), result.m_precision, result.m_rays_per_second, result.m_hit_rate,
+                     i + 1 < results.m_primitives.size() ? "," : "");
+    }
+
+    std::fprintf(file, "  ],\n  \"shading\": [\n");
+    for (auto i = 0uz; i < results.m_shading.size(); i++) {
+        auto const& result = results.m_shading[i];
+
+        std::fprintf(file, "    { \"name\": \"%s\", \"precision\": \"%s\", \"calls_per_second\": %.6g }%s\n",
+                     result.m_name.c_str(), result.m_precision, result.m_calls_per_second,
+                     i + 1 < results.m_shading.size() ? "," : "");
+    }
+
+    std::fprintf(file, "  ],\n  \"scenes\": [\n");
+    for (auto i = 0uz; i < results.m_scenes.size(); i++) {
+        auto const& result = results.m_scenes[i];
+
+        std::fprintf(file, "    { \"scene\": \"%s\", \"precision\": \"%s\", \"shapes\": %zu, \"threads\": %zu, \"build_ms\": %.3f, \"render_ms\": %.3f, \"mrays_per_second\": %.6g }%s\n",
+                     result.m_scene, result.m_precision, result.m_shapes, result.m_threads, result.m_build_ms,
+                     result.m_render_ms, result.m_mrays_per_second, i + 1 < results.m_scenes.size() ? "," : "");
+    }
+
+    std::fprintf(file, "  ],\n  \"tiling\": [\n");
+    for (auto i = 0uz; i < results.m_tiling.size(); i++) {
+        auto const& result = results.m_tiling[i];
+
+        std::fprintf(file, "    { \"order\": \"%s\", \"size\": %zu, \"render_ms\": %.3f, \"mrays_per_second\": %.6g, \"cache_misses_per_ray\": ",
+                     result.m_order, result.m_size, result.m_render_ms, result.m_mrays_per_second);
+
+        if (result.m_cache_misses_per_ray < 0)
+            std::fprintf(file, "null }%s\n", i + 1 < results.m_tiling.size() ? "," : "");
+        else
+            std::fprintf(file, "%.6g }%s\n", result.m_cache_misses_per_ray, i + 1 < results.m_tiling.size() ? "," : "");
+    }
+
+    std::fprintf(file, "  ]\n}\n");
+    std::fclose(file);
+}
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Options {};
+
+    for (auto i = 1; i < argc; i++) {
+        auto const argument = std::string(argv[i]);
+
+        if (argument.starts_with("--json="))
+            options.m_json = argv[i] + 7;
+        else if (argument == "--quick")
+            options.m_quick = true;
+        else if (argument.starts_with("--width="))
+            options.m_width = std::stoul(argument.substr(8));
+        else if (argument.starts_with("--height="))
+            options.m_height = std::stoul(argument.substr(9));
+        else if (argument == "--pipeline=recursive") {
+            options.m_pipeline = Pipeline::Recursive;
+            options.m_pipeline_name = "recursive";
+        } else if (argument == "--pipeline=wavefront") {
+            options.m_pipeline = Pipeline::Wavefront;
+            options.m_pipeline_name = "wavefront";
+        } else if (argument == "--pipeline=sorted") {
+            options.m_pipeline = Pipeline::SortedWavefront;
+            options.m_pipeline_name = "sorted";
+        } else {
+            std::fprintf(stderr, "usage: %s [--json=<path>] [--quick] [--width=<pixels>] [--height=<pixels>] [--pipeline=recursive|wavefront|sorted]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // One thread, then doubling up to every hardware thread
+    auto thread_counts = std::vector<std::size_t> { 1 };
+    auto const hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    while (thread_counts.back() < hardware_threads)
+        thread_counts.push_back(std::min<std::size_t>(2 * thread_counts.back(), hardware_threads));
+
+    auto results = Results {};
+
+    bench_primitives<double>(results);
+    bench_primitives<float>(results);
+    bench_shading<double>(results);
+    bench_shading<float>(results);
+
+    struct SceneSizes {
+        char const* m_kind;
+        std::vector<std::size_t> m_counts;
+    };
+
+    auto const scenes = options.m_quick
+        ? std::vector<SceneSizes> { { "spheres", { 1'000, 10'000 } }, { "triangles", { 1'000, 10'000 } }, { "tori", { 16, 64 } } }
+        : std::vector<SceneSizes> { { "spheres", { 1'000, 10'000, 100'000 } }, { "triangles", { 1'000, 10'000, 100'000 } }, { "tori", { 16, 64, 256 } } };
+
+    for (auto&& scene : scenes)
+        for (auto count : scene.m_counts) {
+            bench_scene<double>(results, options, scene.m_kind, count, thread_counts);
+            bench_scene<float>(results, options, scene.m_kind, count, thread_counts);
+        }
+
+    bench_tiling(results, options, options.m_quick ? 10'000 : 100'000, hardware_threads);
+
+    if (options.m_json)
+        write_json(results, options, thread_counts);
+
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include "../shapes/Torus.h"
+#include "../util/Ray.h"
+#include "../util/Vec.h"
+
+#include <chrono>
+#include <complex>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Per-call cost of Torus::find_intersection against the Durand-Kerner solver it replaced.
+ *
+ * Rays are aimed at random points inside of the torus' bounding box so that most of them reach the solver.
+ */
+
+namespace Legacy {
+    // Durand-Kerner iteration on the complex plane, as Torus used to do it. The static lambdas of the
+    // original captured the coefficients of the first call, they are plain locals here.
+    double find_smallest_real_quartic_root(std::complex<double> a, std::complex<double> b, std::complex<double> c, std::complex<double> d)
+    {
+        auto P = std::complex<double>(1.);
+        auto Q = std::complex<double>(.4, .9);
+        auto R = Q * Q;
+        auto S = R * Q;
+
+        std::complex<double> Phat, Qhat, Rhat, Shat;
+        double smallest_root = std::numeric_limits<double>::infinity();
+
+        auto const is_within_threshold = [](auto const& a, auto const& b) {
+            return std::abs(a - b) < 0.00001;
+        };
+        auto const evaluate_polynomial = [&a, &b, &c, &d](auto const& x) {
+            return d + x * (c + x * (b + x * (a + x)));
+        };
+        auto const get_next_point = [&](auto const& x, auto const& p, auto const& q, auto const& r) {
+            return x - evaluate_polynomial(x) / ((x - p) * (x - q) * (x - r));
+        };
+
+        auto running = true;
+        while (running) {
+            for (auto i = 0; i < 250'000; i++) {
+                Phat = get_next_point(P, Q, R, S);
+                Qhat = get_next_point(Q, P, R, S);
+                Rhat = get_next_point(R, P, Q, S);
+                Shat = get_next_point(S, P, Q, R);
+
+                if (is_within_threshold(Phat, P)
+                    && is_within_threshold(Qhat, Q)
+                    && is_within_threshold(Rhat, R)
+                    && is_within_threshold(Shat, S)) {
+                    running = false;
+                    break;
+                }
+
+                P = Phat;
+                Q = Qhat;
+                R = Rhat;
+                S = Shat;
+            }
+
+            P = std::complex<double>(1.);
+            Q = std::complex<double>(static_cast<double>(rand()) / RAND_MAX, static_cast<double>(rand()) / RAND_MAX);
+            R = Q * Q;
+            S = R * Q;
+        }
+
+        for (auto&& root : { Phat, Qhat, Rhat, Shat })
+            if (std::abs(root.imag()) < 0.00001)
+                smallest_root = std::min(smallest_root, root.real());
+
+        return smallest_root;
+    }
+
+    double find_intersection(Vec3<double> center, double major_radius, double minor_radius, Ray const& ray, double min, double max)
+    {
+        auto const P = ray.get_origin() - center;
+        auto const T = 4. * major_radius * major_radius;
+        auto const G = T * (ray.get_direction().x * ray.get_direction().x + ray.get_direction().y * ray.get_direction().y);
+        auto const H = 2. * T * (P.x * ray.get_direction().x + P.y * ray.get_direction().y);
+        auto const I = T * (P.x * P.x + P.y * P.y);
+        auto const J = dot(ray.get_direction(), ray.get_direction());
+        auto const K = 2. * dot(ray.get_direction(), P);
+        auto const L = dot(P, P) + major_radius * major_radius - minor_radius * minor_radius;
+        auto const M = 1. / (J * J);
+
+        auto root = find_smallest_real_quartic_root(
+            M * (2 * J * K),
+            M * (2 * J * L + K * K - G),
+            M * (2 * K * L - H),
+            M * (L * L - I));
+
+        return std::min(std::max(root, min), max);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto const count = argc > 1 ? std::stoul(argv[1]) : 20'000ul;
+
+    auto const center = Vec3<double> { -1., -.7, 3. };
+    auto const major_radius = .5;
+    auto const minor_radius = .1;
+    auto const torus = Torus(center, major_radius, minor_radius, MaterialId {});
+
+    auto rng = std::mt19937 { 0 };
+    auto uniform = std::uniform_real_distribution<double>(-1., 1.);
+
+    auto rays = std::vector<Ray> {};
+    rays.reserve(count);
+
+    for (auto i = 0ul; i < count; i++) {
+        auto origin = center + Vec3<double> { uniform(rng), uniform(rng), uniform(rng) + 3. };
+        auto target = center + Vec3<double> { .6 * uniform(rng), .6 * uniform(rng), .1 * uniform(rng) };
+
+        rays.push_back(Ray(origin, normalize(target - origin)));
+    }
+
+    auto const infinity = std::numeric_limits<double>::infinity();
+
+    auto time = [&](auto&& intersect) {
+        auto hits = 0ul;
+        auto start = std::chrono::steady_clock::now();
+
+        for (auto&& ray : rays) {
+            auto const t = intersect(ray);
+            hits += t > 0. && t < infinity;
+        }
+
+        auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        return std::make_pair(elapsed / count, hits);
+    };
+
+    auto [legacy_ns, legacy_hits] = time([&](Ray const& ray) {
+        return Legacy::find_intersection(center, major_radius, minor_radius, ray, 0., infinity);
+    });
+
+    auto [closed_form_ns, closed_form_hits] = time([&](Ray const& ray) {
+        return torus.find_intersection(ray, 0., infinity);
+    });
+
+    // Largest disagreement on the time of intersection for rays both solvers report as hits
+    auto max_difference = 0.;
+
+    for (auto&& ray : rays) {
+        auto a = Legacy::find_intersection(center, major_radius, minor_radius, ray, 0., infinity);
+        auto b = torus.find_intersection(ray, 0., infinity);
+
+        if (a > 0. && a < infinity && b > 0. && b < infinity)
+            max_difference = std::max(max_difference, std::abs(a - b));
+    }
+
+    std::printf("rays: %lu\n", count);
+    std::printf("durand-kerner: %10.1f ns/call, %lu hits\n", legacy_ns, legacy_hits);
+    std::printf("closed form:   %10.1f ns/call, %lu hits\n", closed_form_ns, closed_form_hits);
+    std::printf("speedup: %.1fx, max |dt| on common hits: %.3g\n", legacy_ns / closed_form_ns, max_difference);
+
+    return 0;
+}
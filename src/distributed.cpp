@@ -0,0 +1,96 @@
+#include "util/Image.h"
+
+#include "Camera.h"
+#include "Distributed.h"
+#include "Scene.h"
+#include "SceneFile.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <unistd.h>
+
+/**
+ * Renders a scene file with worker processes
+ *
+ *   distributed <scene> <workers> [<output>]
+ *   distributed --worker <socket>
+ *
+ * The first form starts the given number of local workers, renders the scene with them over a Unix socket
+ * and writes the image (render.png by default). The second runs a worker for a coordinator listening at the
+ * socket, for coordinators that do not start their own.
+ */
+
+int main(int argc, char** argv)
+{
+    using Clock = std::chrono::steady_clock;
+
+    if (argc == 3 && std::strcmp(argv[1], "--worker") == 0)
+        return Raytracer::Distributed::serve<double>(argv[2]) ? 0 : 1;
+
+    if (argc < 3 || argc > 4) {
+        std::fprintf(stderr, "usage: %s <scene> <workers> [<output>]\n       %s --worker <socket>\n", argv[0], argv[0]);
+        return 1;
+    }
+
+    auto const workers = std::strtoul(argv[2], nullptr, 10);
+    auto const output = std::string(argc == 4 ? argv[3] : "render.png");
+    auto const socket = "/tmp/raytracer-" + std::to_string(::getpid()) + ".sock";
+
+    auto coordinator = RenderCoordinator();
+
+    if (!workers || !coordinator.listen(socket)) {
+        std::fprintf(stderr, "%s: could not listen\n", socket.c_str());
+        return 1;
+    }
+
+    // Workers are forked before the scene is loaded, they get it from the coordinator like remote ones
+    for (auto i = 0ul; i < workers; i++)
+        if (::fork() == 0)
+            std::_Exit(Raytracer::Distributed::serve<double>(socket) ? 0 : 1);
+
+    auto scene = Scene();
+    auto description = SceneDescription {};
+    auto error = std::string {};
+
+    if (!Raytracer::SceneFile::load(argv[1], scene, description, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    auto const start = Clock::now();
+
+    if (!coordinator.accept(workers) || !coordinator.send_scene(scene, description)) {
+        std::fprintf(stderr, "%s: no workers\n", socket.c_str());
+        return 1;
+    }
+
+    auto const sent = Clock::now();
+    auto const camera = description.make_camera();
+    auto pixels = std::vector<Vec3<uint8_t>> {};
+
+    if (!coordinator.render(camera, pixels)) {
+        std::fprintf(stderr, "all workers failed\n");
+        return 1;
+    }
+
+    std::printf(
+        "%zu workers: scene sent in %.1f ms, rendered in %.1f ms\n",
+        coordinator.get_worker_count(),
+        1e3 * std::chrono::duration<double>(sent - start).count(),
+        1e3 * std::chrono::duration<double>(Clock::now() - sent).count());
+
+    auto const written = output.ends_with(".ppm")
+        ? Raytracer::Image::write_ppm(output, pixels, description.m_width, description.m_height)
+        : Raytracer::Image::write_png(output, pixels, description.m_width, description.m_height);
+
+    if (!written) {
+        std::fprintf(stderr, "%s: could not be written\n", output.c_str());
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,6 +1,8 @@
 #include "util/BoundingBox.h"
+#include "util/Image.h"
 #include "util/Material.h"
 #include "util/Ray.h"
+#include "util/Stats.h"
 #include "util/Vec.h"
 
 #include "shapes/Plane.h"
@@ -12,7 +14,6 @@
 #include "Scene.h"
 
 #include <cstddef>
-#include <fstream>
 
 int main(int argc, char** argv)
 {
@@ -35,58 +36,53 @@ int main(int argc, char** argv)
     scene.add_light(std::make_shared<Light>(Vec3 { 0., 3., -2. }, Vec3 { .2 }));
     scene.add_light(std::make_shared<Light>(Vec3 { -2., 1., 4. }, Vec3 { .5 }));
 
-    auto generic_diffuse = Material {
+    auto generic_diffuse = scene.add_material(Material {
         Vec3 { .1 },
         Vec3 { 1. },
         Vec3 { 0. },
         Vec3 { 0. },
         1.,
-        2.5
-    };
+        2.5 });
+
+    auto mirror = scene.add_material(Material {
+        Vec3 { 0. },
+        Vec3 { 0. },
+        Vec3 { 0. },
+        Vec3 { 1. },
+        1.,
+        1. });
 
     scene.add_shape(std::make_shared<Sphere>(
         Vec3 { -1., -.7, 3. },
         .3,
-        Material {
+        scene.add_material(Material {
             Vec3 { .1 },
             Vec3 { .3, .6, .3 },
             Vec3 { 1. },
             Vec3 { .1, .4, .1 },
             0.135,
-            2.5 }));
+            2.5 })));
 
     scene.add_shape(std::make_shared<Sphere>(
         Vec3 { 1., -.5, 3. },
         .5,
-        Material {
+        scene.add_material(Material {
             Vec3 { .1 },
             Vec3 { 1., .0, 0. },
             Vec3 { 1. },
             Vec3 { 0. },
             0.2,
-            2.5 }));
+            2.5 })));
 
     scene.add_shape(std::make_shared<Sphere>(
         Vec3 { -1., 0., 0. },
         1.,
-        Material {
-            Vec3 { 0. },
-            Vec3 { 0. },
-            Vec3 { 0. },
-            Vec3 { 1. },
-            1.,
-            1. }));
+        mirror));
 
     scene.add_shape(std::make_shared<Sphere>(
         Vec3 { 1., 0., -1. },
         1.,
-        Material {
-            Vec3 { 0. },
-            Vec3 { 0. },
-            Vec3 { 0. },
-            Vec3 { 1. },
-            1.,
-            1. }));
+        mirror));
 
     scene.add_shape(std::make_shared<Plane>(
         Vec3 { -1., -3., 0. },
@@ -102,34 +98,37 @@ int main(int argc, char** argv)
         Vec3 { 2., 0., -1. },
         Vec3 { 2.75, 3., -.5 },
         Vec3 { 3., .5, 1. },
-        Material {
+        scene.add_material(Material {
             Vec3 { .1 },
             Vec3 { .2, .2, 1. },
             Vec3 { 1. },
             Vec3 { 0. },
             0.75,
-            2.5 }));
+            2.5 })));
 
     scene.add_shape(std::make_shared<Torus>(
         Vec3 { -1., -.7, 3. },
         .5,
         .1,
-        Material {
+        scene.add_material(Material {
             Vec3 { .1 },
             Vec3 { 0. },
             Vec3 { 1. },
             Vec3 { .8 },
-            100. }));
+            100. })));
 
-    auto pixels = camera.render(scene);
+    scene.build();
 
-    auto out = std::ofstream("test.pbm");
+    auto pixels = camera.render(scene);
 
-    out << "P3\n"
-        << width << ' ' << height << "\n255\n";
+    Raytracer::Image::write_ppm("test.ppm", pixels, width, height);
+    Raytracer::Image::write_png("test.png", pixels, width, height);
 
-    for (auto&& pixel : pixels)
-        out << (+pixel.x) << '\t' << (+pixel.y) << '\t' << (+pixel.z) << '\t';
+#ifdef RAYTRACER_ENABLE_STATS
+    // Cost of every pixel next to the render, and where the time went
+    Raytracer::Image::write_png("test_cost.png", Raytracer::Stats::heatmap(camera.get_stats()), width, height);
+    Raytracer::Stats::write_report(stdout, camera.get_stats());
+#endif
 
     return 0;
 }
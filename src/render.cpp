@@ -0,0 +1,78 @@
+#include "util/Image.h"
+
+#include "Camera.h"
+#include "Scene.h"
+#include "SceneFile.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+/**
+ * Renders a scene file
+ *
+ *   render <scene> [<output>]
+ *   render --compile <scene>
+ *
+ * The scene is loaded through its cache (<scene>.cache), which is written whenever it is missing or out of
+ * date; --compile only writes the cache. The image is written as PNG, or as PPM if the output ends in .ppm.
+ */
+
+int main(int argc, char** argv)
+{
+    using Clock = std::chrono::steady_clock;
+
+    auto const compile = argc > 1 && std::strcmp(argv[1], "--compile") == 0;
+    auto const arguments = argc - compile;
+
+    if (arguments < 2 || arguments > (compile ? 2 : 3)) {
+        std::fprintf(stderr, "usage: %s <scene> [<output>]\n       %s --compile <scene>\n", argv[0], argv[0]);
+        return 1;
+    }
+
+    auto const path = std::string(argv[1 + compile]);
+    auto const output = std::string(arguments == 3 ? argv[2] : "render.png");
+
+    auto scene = Scene();
+    auto description = SceneDescription {};
+    auto error = std::string {};
+    auto const start = Clock::now();
+
+    if (compile) {
+        if (!Raytracer::SceneFile::load_text(path, scene, description, &error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+
+        if (!Raytracer::SceneFile::write_cache(path + ".cache", scene, description)) {
+            std::fprintf(stderr, "%s.cache: could not be written\n", path.c_str());
+            return 1;
+        }
+
+        std::printf("compiled %s.cache in %.1f ms\n", path.c_str(), 1e3 * std::chrono::duration<double>(Clock::now() - start).count());
+
+        return 0;
+    }
+
+    if (!Raytracer::SceneFile::load(path, scene, description, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    std::printf("loaded %s in %.1f ms\n", path.c_str(), 1e3 * std::chrono::duration<double>(Clock::now() - start).count());
+
+    auto camera = description.make_camera();
+    auto const pixels = camera.render(scene);
+
+    auto const written = output.ends_with(".ppm")
+        ? Raytracer::Image::write_ppm(output, pixels, description.m_width, description.m_height)
+        : Raytracer::Image::write_png(output, pixels, description.m_width, description.m_height);
+
+    if (!written) {
+        std::fprintf(stderr, "%s: could not be written\n", output.c_str());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+#include "../util/BVH.h"
+#include "../util/Binary.h"
+#include "../util/Ray.h"
+#include "Shape.h"
+
+/**
+ * Shapes put together once to be placed many times as instances (see Instance.h), e.g. a tree of a forest
+ *
+ * A group is not part of the scene itself: it keeps its shapes and a BVH over them in its own space, and
+ * every instance refers to it. The elements of a group number the elements of all of its shapes one after
+ * the other, so that an instance can report which element of which shape was hit. Only shapes with a finite
+ * bounding box can be grouped.
+ */
+template <std::floating_point T>
+class BasicGroup {
+private:
+    std::vector<std::shared_ptr<BasicShape<T>>> m_shapes;
+
+    // Element of the group of the first element of every shape, and the element count at the end
+    std::vector<uint32_t> m_first_elements;
+
+    BasicBVH<T> m_bvh;
+    BasicBoundingBox<T> m_bounding_box;
+
+    // The shape an element of the group belongs to
+    std::size_t find_shape(uint32_t element) const
+    {
+        return std::upper_bound(m_first_elements.begin(), m_first_elements.end(), element) - m_first_elements.begin() - 1;
+    }
+
+    // Numbers the elements of the shapes, returning their boxes
+    std::vector<BasicBoundingBox<T>> index()
+    {
+        auto boxes = std::vector<BasicBoundingBox<T>> {};
+
+        m_first_elements.assign(1, 0);
+        m_bounding_box = BasicBoundingBox<T>::empty();
+
+        for (auto&& shape : m_shapes) {
+            assert(shape->get_bounding_box().is_bounded());
+
+            m_first_elements.push_back(m_first_elements.back() + shape->get_element_count());
+            boxes.push_back(shape->get_bounding_box());
+            m_bounding_box.merge(shape->get_bounding_box());
+        }
+
+        return boxes;
+    }
+
+public:
+    BasicGroup()
+        : m_shapes({})
+        , m_first_elements({ 0 })
+        , m_bvh({})
+        , m_bounding_box(BasicBoundingBox<T>::empty()) {};
+
+    void add_shape(std::shared_ptr<BasicShape<T>> shape)
+    {
+        m_shapes.push_back(std::move(shape));
+    }
+
+    // Must be called after the last add_shape() and before the group is instanced.
+    void build()
+    {
+        m_bvh.build(index());
+    }
+
+    auto const& get_shapes() const { return m_shapes; }
+    auto const& get_bounding_box() const { return m_bounding_box; }
+    auto get_element_count() const { return m_first_elements.back(); }
+
+    // Snapshot of the BVH of the group; the shapes themselves are not included, like Scene::write_build().
+    void write_build(Raytracer::Binary::Writer& writer) const
+    {
+        m_bvh.write(writer);
+    }
+
+    // Restores a snapshot written for the same shapes, added in the same order, in place of build().
+    bool read_build(Raytracer::Binary::Reader& reader)
+    {
+        index();
+
+        return m_bvh.read(reader);
+    }
+
+    Vec3<T> get_normal(Vec3<T> const& point, uint32_t element) const
+    {
+        auto const shape = find_shape(element);
+
+        return m_shapes[shape]->get_normal(point, element - m_first_elements[shape]);
+    }
+
+    MaterialId get_material(uint32_t element) const
+    {
+        auto const shape = find_shape(element);
+
+        return m_shapes[shape]->get_material(element - m_first_elements[shape]);
+    }
+
+    // Closest intersection inside of (min, max) and the element hit, or max
+    T find_intersection(BasicRay<T> const& ray, T min, T max, uint32_t& element) const
+    {
+        return m_bvh.traverse(ray, min, max, [&](auto index, T max) {
+            auto shape_element = 0u;
+            auto const time = m_shapes[index]->find_intersection(ray, min, max, shape_element);
+
+            if (time > min && time < max)
+                element = m_first_elements[index] + shape_element;
+
+            return time;
+        });
+    }
+
+    bool intersects(BasicRay<T> const& ray, T min, T max) const
+    {
+        return m_bvh.occluded(ray, min, max, [&](auto index) { return m_shapes[index]->intersects(ray, min, max); });
+    }
+};
+
+using Group = BasicGroup<double>;
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cassert>
+#include <limits>
+#include <memory>
+
+#include "../util/Ray.h"
+#include "../util/RayPacket.h"
+#include "../util/Stats.h"
+#include "../util/Transform.h"
+#include "Group.h"
+#include "Shape.h"
+
+/**
+ * A group placed in the scene with a transform, optionally with a material of its own for all of its shapes
+ *
+ * Instances share their group, so a scene of many copies of a few groups stores the shapes of every group
+ * once, plus a transform per instance. The BVH of the scene over the boxes of the instances is the top level
+ * of a two level hierarchy, the BVH of every group the bottom one: rays reaching an instance are transformed
+ * into the space of its group and traced through the BVH of the group. Elements are those of the group.
+ */
+template <std::floating_point T>
+class BasicInstance : public BasicShape<T> {
+private:
+    std::shared_ptr<BasicGroup<T> const> m_group;
+
+    // From the space of the group to the scene, and back
+    BasicTransform<T> m_transform;
+    BasicTransform<T> m_inverse;
+
+    // The ray in the space of the group with a unit direction, and how much longer it is there; times along
+    // it are that much larger than along the ray.
+    BasicRay<T> to_group(BasicRay<T> const& ray, T& scale) const
+    {
+        auto direction = m_inverse.apply_vector(ray.get_direction());
+
+        scale = direction.magnitude();
+
+        return BasicRay<T>(m_inverse.apply_point(ray.get_origin()), direction / scale);
+    }
+
+public:
+    // Instances without a material of their own use the materials of the shapes of the group.
+    static constexpr MaterialId group_materials = std::numeric_limits<MaterialId>::max();
+
+    BasicInstance(std::shared_ptr<BasicGroup<T> const> group, BasicTransform<T> const& transform, MaterialId material = group_materials)
+        : BasicShape<T>(transform.apply(group->get_bounding_box()), material)
+        , m_group(std::move(group))
+        , m_transform(transform)
+        , m_inverse(transform.inverse()) {};
+
+    auto const& get_group() const { return m_group; }
+    auto const& get_transform() const { return m_transform; }
+
+    using BasicShape<T>::get_material;
+
+    MaterialId get_material(uint32_t element) const override
+    {
+        auto const material = BasicShape<T>::get_material();
+
+        return material == group_materials ? m_group->get_material(element) : material;
+    }
+
+    uint32_t get_element_count() const override { return m_group->get_element_count(); }
+
+    void translate(Vec3<T> const& offset) override
+    {
+        *this = BasicInstance(m_group, BasicTransform<T>::translation(offset) * m_transform, BasicShape<T>::get_material());
+    }
+
+    Vec3<T> get_normal(Vec3<T> point) const override
+    {
+        return get_normal(point, 0);
+    }
+
+    // Normals are transformed by the inverse transpose, which keeps them perpendicular under scaling.
+    Vec3<T> get_normal(Vec3<T> point, uint32_t element) const override
+    {
+        return normalize(m_inverse.apply_transposed(m_group->get_normal(m_inverse.apply_point(point), element)));
+    }
+
+    T find_intersection(BasicRay<T> const& ray, T min, T max) const override
+    {
+        auto element = 0u;
+
+        return find_intersection(ray, min, max, element);
+    }
+
+    T find_intersection(BasicRay<T> const& ray, T min, T max, uint32_t& element) const override
+    {
+        RAYTRACER_STATS(Raytracer::Stats::count(Raytracer::Stats::InstanceTests));
+
+        auto scale = T {};
+        auto const local = to_group(ray, scale);
+        auto const time = m_group->find_intersection(local, min * scale, max * scale, element);
+
+        return time > min * scale && time < max * scale ? time / scale : max;
+    }
+
+    PacketMaskOf<T> find_intersection(BasicRayPacket<T> const& packet, PacketMaskOf<T> active, T min, PacketOf<T>& times) const override
+    {
+        auto elements = PacketIndexOf<T> {};
+
+        return find_intersection(packet, active, min, times, elements);
+    }
+
+    // Each lane on its own, every one of them is transformed anyway
+    PacketMaskOf<T> find_intersection(BasicRayPacket<T> const& packet, PacketMaskOf<T> active, T min, PacketOf<T>& times, PacketIndexOf<T>& elements) const override
+    {
+        auto hits = PacketMaskOf<T> {};
+
+        for (auto lane = 0uz; lane < Raytracer::Packet::width<T>; lane++) {
+            if (!active[lane])
+                continue;
+
+            auto element = 0u;
+            auto const time = find_intersection(packet.get_ray(lane), min, times[lane], element);
+
+            if (time > min && time < times[lane]) {
+                times[lane] = time;
+                elements[lane] = static_cast<Raytracer::Packet::Integer<T>>(element);
+                hits[lane] = -1;
+            }
+        }
+
+        return hits;
+    }
+
+    bool intersects(BasicRay<T> const& ray, T min, T max) const override
+    {
+        RAYTRACER_STATS(Raytracer::Stats::count(Raytracer::Stats::InstanceTests));
+
+        auto scale = T {};
+        auto const local = to_group(ray, scale);
+
+        return m_group->intersects(local, min * scale, max * scale);
+    }
+};
+
+using Instance = BasicInstance<double>;
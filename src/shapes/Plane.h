@@ -3,26 +3,60 @@
 #include "../util/Ray.h"
 #include "Shape.h"
 
-class Plane : public Shape {
+template <std::floating_point T>
+class BasicPlane : public BasicShape<T> {
 private:
-    Vec3<double> m_center;
-    Vec3<double> m_normal;
+    Vec3<T> m_center;
+    Vec3<T> m_normal;
 
 public:
-    Plane(auto center, auto normal, auto material)
-        : Shape(material)
+    BasicPlane(auto center, auto normal, auto material)
+        : BasicShape<T>(material)
         , m_center(center)
         , m_normal(normal) {};
 
-    Vec3<double> get_normal(Vec3<double>) const override
+    auto const& get_center() const { return m_center; }
+    auto const& get_normal() const { return m_normal; }
+
+    void translate(Vec3<T> const& offset) override
+    {
+        m_center += offset;
+    }
+
+    Vec3<T> get_normal(Vec3<T>) const override
     {
         return m_normal;
     }
 
-    __attribute__((flatten)) double find_intersection(Ray ray, double min, double max) const override
+    __attribute__((flatten)) T find_intersection(BasicRay<T> const& ray, T min, T max) const override
     {
         auto const val = dot(m_center - ray.get_origin(), m_normal) / dot(m_normal, ray.get_direction());
 
         return std::min(std::max(val, min), max);
     }
+
+    __attribute__((flatten)) PacketMaskOf<T> find_intersection(BasicRayPacket<T> const& packet, PacketMaskOf<T> active, T min, PacketOf<T>& times) const override
+    {
+        return find_intersection(packet, active, m_center, m_normal, min, times);
+    }
+
+    // Packet kernel, shared with the plane arrays of the scene
+    static PacketMaskOf<T> find_intersection(BasicRayPacket<T> const& packet, PacketMaskOf<T> active, Vec3<T> const& center, Vec3<T> const& normal, T min, PacketOf<T>& times)
+    {
+        using namespace Raytracer;
+
+        PacketOf<T> to_center[3];
+
+        for (auto axis = 0uz; axis < 3; axis++)
+            to_center[axis] = center[axis] - packet.get_origin()[axis];
+
+        auto const time = Packet::dot(to_center, normal) / Packet::dot(packet.get_direction(), normal);
+        auto const hits = active & (time > min) & (time < times);
+
+        times = hits ? time : times;
+
+        return hits;
+    }
 };
+
+using Plane = BasicPlane<double>;
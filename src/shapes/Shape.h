@@ -1,27 +1,98 @@
 #pragma once
 
+#include <concepts>
+
 #include "../util/BoundingBox.h"
 #include "../util/Material.h"
+#include "../util/RayPacket.h"
 
-class Shape {
+/**
+ * Base class of the shapes of a scene, for rendering in the precision T
+ *
+ * Shapes, rays, materials and the scene are templates on the scalar type; the names without the Basic prefix
+ * (Shape, Sphere, Scene, ...) are their double precision versions.
+ */
+template <std::floating_point T>
+class BasicShape {
 private:
-    BoundingBox m_bounding_box;
-    Material m_material;
+    BasicBoundingBox<T> m_bounding_box;
+    MaterialId m_material;
 
 public:
-    Shape(Material material)
-        : m_bounding_box(BoundingBox {})
+    BasicShape(MaterialId material)
+        : m_bounding_box(BasicBoundingBox<T> {})
         , m_material(material) {};
 
-    Shape(BoundingBox bounding_box, Material material)
+    BasicShape(BasicBoundingBox<T> bounding_box, MaterialId material)
         : m_bounding_box(bounding_box)
         , m_material(material) {};
 
     auto const& get_bounding_box() const { return m_bounding_box; }
-    auto const& get_material() const { return m_material; }
+    auto get_material() const { return m_material; }
+
+    void set_bounding_box(BasicBoundingBox<T>&& bounding_box) { m_bounding_box = std::move(bounding_box); }
+
+    // Moves the shape as if it had been made at its new position; the scene must be refit() afterwards.
+    virtual void translate(Vec3<T> const& offset) = 0;
+
+    virtual Vec3<T> get_normal(Vec3<T> point) const = 0;
+    virtual T find_intersection(BasicRay<T> const& ray, T min, T max) const = 0;
+
+    // Shapes made of several elements (e.g. the triangles of a mesh) report which element was hit, and get
+    // it back to compute the normal. Other shapes only have element 0.
+    virtual T find_intersection(BasicRay<T> const& ray, T min, T max, uint32_t&) const
+    {
+        return find_intersection(ray, min, max);
+    }
+
+    virtual Vec3<T> get_normal(Vec3<T> point, uint32_t) const
+    {
+        return get_normal(point);
+    }
+
+    virtual uint32_t get_element_count() const { return 1; }
+
+    // Shapes made of several shapes (instances) may have a material per element.
+    virtual MaterialId get_material(uint32_t) const { return m_material; }
 
-    void set_bounding_box(BoundingBox&& bounding_box) { m_bounding_box = std::move(bounding_box); }
+    /**
+     * Intersects the active lanes of a packet, updating times for the lanes where the shape is hit inside of
+     * (min, times) and returning those lanes. Shapes with a vectorized kernel override this; the default
+     * traces each lane on its own.
+     */
+    virtual PacketMaskOf<T> find_intersection(BasicRayPacket<T> const& packet, PacketMaskOf<T> active, T min, PacketOf<T>& times) const
+    {
+        auto hits = PacketMaskOf<T> {};
 
-    virtual Vec3<double> get_normal(Vec3<double> point) const = 0;
-    virtual double find_intersection(Ray ray, double min, double max) const = 0;
+        for (auto lane = 0uz; lane < Raytracer::Packet::width<T>; lane++) {
+            if (!active[lane])
+                continue;
+
+            auto const time = find_intersection(packet.get_ray(lane), min, times[lane]);
+
+            if (time > min && time < times[lane]) {
+                times[lane] = time;
+                hits[lane] = -1;
+            }
+        }
+
+        return hits;
+    }
+
+    // As above, also setting elements for the lanes that hit.
+    virtual PacketMaskOf<T> find_intersection(BasicRayPacket<T> const& packet, PacketMaskOf<T> active, T min, PacketOf<T>& times, PacketIndexOf<T>&) const
+    {
+        return find_intersection(packet, active, min, times);
+    }
+
+    // Whether the ray hits the shape inside of (min, max); shapes may override this with a cheaper test
+    // since the time of intersection is not needed.
+    virtual bool intersects(BasicRay<T> const& ray, T min, T max) const
+    {
+        auto const time = find_intersection(ray, min, max);
+
+        return time > min && time < max;
+    }
 };
+
+using Shape = BasicShape<double>;
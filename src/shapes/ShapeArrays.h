@@ -0,0 +1,431 @@
+#pragma once
+
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "../util/Binary.h"
+#include "../util/Ray.h"
+#include "../util/RayPacket.h"
+#include "../util/Record.h"
+#include "../util/Stats.h"
+#include "Plane.h"
+#include "Sphere.h"
+#include "Triangle.h"
+
+/**
+ * Structure of arrays copies of the spheres, planes and triangles of a scene
+ *
+ * Scene::build() fills these in the order its BVH stores the primitives so that the shapes of a leaf are
+ * adjacent. The kernels test one ray against a range of shapes a full packet of shapes at a time, with the
+ * same arithmetic as the Shape classes so both give identical results. The arrays are padded with a packet
+ * width of unused entries so that the last range can be loaded whole; lanes past the range are masked.
+ */
+
+namespace Raytracer {
+
+namespace ShapeArrays {
+    // Lanes below count
+    template <std::floating_point T>
+    PacketMaskOf<T> inline first_lanes(std::size_t count)
+    {
+        auto result = PacketMaskOf<T> {};
+
+        for (auto lane = 0uz; lane < Packet::width<T>; lane++)
+            result[lane] = lane < count ? -1 : 0;
+
+        return result;
+    }
+}
+
+}
+
+// Fields of one shape type, each in an array of its own, and the scene index of every shape.
+template <std::floating_point T, std::size_t Fields>
+class ShapeArray {
+protected:
+    std::array<std::vector<T>, Fields> m_fields;
+    std::vector<uint32_t> m_shapes;
+    uint32_t m_size;
+
+    void push(std::array<T, Fields> const& values, uint32_t shape)
+    {
+        for (auto field = 0uz; field < Fields; field++)
+            m_fields[field].push_back(values[field]);
+
+        m_shapes.push_back(shape);
+        m_size++;
+    }
+
+    T get(std::size_t field, std::size_t index) const { return m_fields[field][index]; }
+
+    // Values of a field for the packet width of shapes starting at index
+    PacketOf<T> load(std::size_t field, std::size_t index) const
+    {
+        auto result = PacketOf<T> {};
+        std::memcpy(&result, m_fields[field].data() + index, sizeof(result));
+        return result;
+    }
+
+    /**
+     * Keeps the closest of the hits of the packet width of shapes starting at index, in order so that ties
+     * go to the first shape as with one shape at a time, and returns the new closest time.
+     */
+    T closest(PacketMaskOf<T> const& hits, PacketOf<T> const& times, std::size_t index, T max, BasicHit<T>& hit) const
+    {
+        for (auto lane = 0uz; lane < Raytracer::Packet::width<T>; lane++)
+            if (hits[lane] && times[lane] < max) {
+                max = times[lane];
+                hit = { max, m_shapes[index + lane], 0 };
+            }
+
+        return max;
+    }
+
+    // Records the lanes of a packet that hit shape index closer than before
+    void record(PacketMaskOf<T> const& closer, std::size_t index, BasicPacketHit<T>& hit) const
+    {
+        hit.m_shape = closer ? static_cast<Raytracer::Packet::Integer<T>>(m_shapes[index]) : hit.m_shape;
+        hit.m_element = closer ? 0 : hit.m_element;
+    }
+
+public:
+    ShapeArray()
+        : m_fields({})
+        , m_shapes({})
+        , m_size(0) {};
+
+    // Number of shapes, not counting the padding
+    auto size() const { return m_size; }
+
+    void clear()
+    {
+        for (auto&& field : m_fields)
+            field.clear();
+
+        m_shapes.clear();
+        m_size = 0;
+    }
+
+    // Snapshot of the arrays, padding included
+    void write(Raytracer::Binary::Writer& writer) const
+    {
+        writer.write(m_fields);
+        writer.write(m_shapes);
+        writer.write(m_size);
+    }
+
+    bool read(Raytracer::Binary::Reader& reader)
+    {
+        return reader.read(m_fields) && reader.read(m_shapes) && reader.read(m_size);
+    }
+
+    // Must be called after the last shape is added
+    void pad()
+    {
+        for (auto&& field : m_fields)
+            field.resize(m_size + Raytracer::Packet::width<T>, T {});
+
+        m_shapes.resize(m_size + Raytracer::Packet::width<T>, BasicHit<T>::miss);
+    }
+};
+
+template <std::floating_point T>
+class BasicSphereArray : public ShapeArray<T, 4> {
+private:
+    using ShapeArray<T, 4>::get;
+    using ShapeArray<T, 4>::load;
+
+    enum Field { X, Y, Z, Radius2 };
+
+    // b and the discriminant of the quadratic of every lane; see Sphere::find_intersection()
+    void solve(BasicRay<T> const& ray, uint32_t i, PacketOf<T>& b, PacketOf<T>& discriminant) const
+    {
+        auto const& O = ray.get_origin();
+        auto const& D = ray.get_direction();
+
+        auto const ocx = O.x - load(X, i);
+        auto const ocy = O.y - load(Y, i);
+        auto const ocz = O.z - load(Z, i);
+
+        b = D.x * ocx + D.y * ocy + D.z * ocz;
+        discriminant = b * b - ((ocx * ocx + ocy * ocy + ocz * ocz) - load(Radius2, i));
+    }
+
+public:
+    void add(BasicSphere<T> const& sphere, uint32_t shape)
+    {
+        auto const& center = sphere.get_center();
+
+        this->push({ center.x, center.y, center.z, sphere.get_radius() * sphere.get_radius() }, shape);
+    }
+
+    // Closest hit among spheres [begin, begin + count) inside of (min, max); returns its time, or max.
+    T find_intersection(BasicRay<T> const& ray, uint32_t begin, uint32_t count, T min, T max, BasicHit<T>& hit) const
+    {
+        using namespace Raytracer;
+
+        for (auto i = begin; i < begin + count; i += Packet::width<T>) {
+            RAYTRACER_STATS(Stats::count(Stats::SphereTests, std::min<std::size_t>(Packet::width<T>, begin + count - i)));
+
+            PacketOf<T> b, discriminant;
+            solve(ray, i, b, discriminant);
+
+            // Clamped so that lanes which miss do not take the slow path of sqrt() for negative arguments
+            auto const time = -(Packet::sqrt(Packet::max(discriminant, PacketOf<T> {})) + b);
+            auto const hits = ShapeArrays::first_lanes<T>(begin + count - i) & (discriminant >= 0) & (time > min) & (time < max);
+
+            if (Packet::any(hits))
+                max = this->closest(hits, time, i, max, hit);
+        }
+
+        return max;
+    }
+
+    // Same test as Sphere::intersects()
+    bool intersects(BasicRay<T> const& ray, uint32_t begin, uint32_t count, T min, T max) const
+    {
+        using namespace Raytracer;
+
+        for (auto i = begin; i < begin + count; i += Packet::width<T>) {
+            RAYTRACER_STATS(Stats::count(Stats::SphereTests, std::min<std::size_t>(Packet::width<T>, begin + count - i)));
+
+            PacketOf<T> b, discriminant;
+            solve(ray, i, b, discriminant);
+
+            auto const to_min = -b - min;
+            auto const to_max = -b - max;
+
+            auto const hits = ShapeArrays::first_lanes<T>(begin + count - i) & (discriminant >= 0)
+                              & (to_min > 0) & (to_min * to_min > discriminant)
+                              & ((to_max < 0) | (discriminant > to_max * to_max));
+
+            if (Packet::any(hits))
+                return true;
+        }
+
+        return false;
+    }
+
+    // Closest hits of the active lanes of a packet among spheres [begin, begin + count)
+    PacketMaskOf<T> find_intersection(BasicRayPacket<T> const& packet, PacketMaskOf<T> active, uint32_t begin, uint32_t count, T min, BasicPacketHit<T>& hit) const
+    {
+        auto hits = PacketMaskOf<T> {};
+
+        for (auto i = begin; i < begin + count; i++) {
+            RAYTRACER_STATS(Raytracer::Stats::count(Raytracer::Stats::SphereTests, Raytracer::Stats::lanes(active)));
+
+            auto const closer = BasicSphere<T>::find_intersection(packet, active, { get(X, i), get(Y, i), get(Z, i) }, get(Radius2, i), min, hit.m_time);
+
+            this->record(closer, i, hit);
+            hits |= closer;
+        }
+
+        return hits;
+    }
+};
+
+template <std::floating_point T>
+class BasicPlaneArray : public ShapeArray<T, 6> {
+private:
+    using ShapeArray<T, 6>::get;
+    using ShapeArray<T, 6>::load;
+
+    enum Field { X, Y, Z, NX, NY, NZ };
+
+    // See Plane::find_intersection()
+    PacketOf<T> solve(BasicRay<T> const& ray, uint32_t i) const
+    {
+        auto const& O = ray.get_origin();
+        auto const& D = ray.get_direction();
+
+        auto const nx = load(NX, i);
+        auto const ny = load(NY, i);
+        auto const nz = load(NZ, i);
+
+        return ((load(X, i) - O.x) * nx + (load(Y, i) - O.y) * ny + (load(Z, i) - O.z) * nz)
+               / (nx * D.x + ny * D.y + nz * D.z);
+    }
+
+public:
+    void add(BasicPlane<T> const& plane, uint32_t shape)
+    {
+        auto const& center = plane.get_center();
+        auto const& normal = plane.get_normal();
+
+        this->push({ center.x, center.y, center.z, normal.x, normal.y, normal.z }, shape);
+    }
+
+    T find_intersection(BasicRay<T> const& ray, uint32_t begin, uint32_t count, T min, T max, BasicHit<T>& hit) const
+    {
+        using namespace Raytracer;
+
+        for (auto i = begin; i < begin + count; i += Packet::width<T>) {
+            RAYTRACER_STATS(Stats::count(Stats::PlaneTests, std::min<std::size_t>(Packet::width<T>, begin + count - i)));
+
+            auto const time = solve(ray, i);
+            auto const hits = ShapeArrays::first_lanes<T>(begin + count - i) & (time > min) & (time < max);
+
+            if (Packet::any(hits))
+                max = this->closest(hits, time, i, max, hit);
+        }
+
+        return max;
+    }
+
+    bool intersects(BasicRay<T> const& ray, uint32_t begin, uint32_t count, T min, T max) const
+    {
+        using namespace Raytracer;
+
+        for (auto i = begin; i < begin + count; i += Packet::width<T>) {
+            RAYTRACER_STATS(Stats::count(Stats::PlaneTests, std::min<std::size_t>(Packet::width<T>, begin + count - i)));
+
+            auto const time = solve(ray, i);
+
+            if (Packet::any(ShapeArrays::first_lanes<T>(begin + count - i) & (time > min) & (time < max)))
+                return true;
+        }
+
+        return false;
+    }
+
+    PacketMaskOf<T> find_intersection(BasicRayPacket<T> const& packet, PacketMaskOf<T> active, uint32_t begin, uint32_t count, T min, BasicPacketHit<T>& hit) const
+    {
+        auto hits = PacketMaskOf<T> {};
+
+        for (auto i = begin; i < begin + count; i++) {
+            RAYTRACER_STATS(Raytracer::Stats::count(Raytracer::Stats::PlaneTests, Raytracer::Stats::lanes(active)));
+
+            auto const closer = BasicPlane<T>::find_intersection(
+                packet,
+                active,
+                { get(X, i), get(Y, i), get(Z, i) },
+                { get(NX, i), get(NY, i), get(NZ, i) },
+                min,
+                hit.m_time);
+
+            this->record(closer, i, hit);
+            hits |= closer;
+        }
+
+        return hits;
+    }
+};
+
+template <std::floating_point T>
+class BasicTriangleArray : public ShapeArray<T, 9> {
+private:
+    using ShapeArray<T, 9>::get;
+    using ShapeArray<T, 9>::load;
+
+    enum Field { V0X, V0Y, V0Z, E1X, E1Y, E1Z, E2X, E2Y, E2Z };
+
+    // Times of intersection for every lane, with the lanes inside of the triangles; see MollerTrumbore
+    PacketOf<T> solve(BasicRay<T> const& ray, uint32_t i, PacketMaskOf<T>& inside) const
+    {
+        auto const& O = ray.get_origin();
+        auto const& D = ray.get_direction();
+
+        auto const E1x = load(E1X, i);
+        auto const E1y = load(E1Y, i);
+        auto const E1z = load(E1Z, i);
+        auto const E2x = load(E2X, i);
+        auto const E2y = load(E2Y, i);
+        auto const E2z = load(E2Z, i);
+
+        auto const Sx = O.x - load(V0X, i);
+        auto const Sy = O.y - load(V0Y, i);
+        auto const Sz = O.z - load(V0Z, i);
+
+        auto const S1x = D.y * E2z - D.z * E2y;
+        auto const S1y = D.z * E2x - D.x * E2z;
+        auto const S1z = D.x * E2y - D.y * E2x;
+
+        auto const S2x = Sy * E1z - Sz * E1y;
+        auto const S2y = Sz * E1x - Sx * E1z;
+        auto const S2z = Sx * E1y - Sy * E1x;
+
+        auto const invS1E1 = 1 / (S1x * E1x + S1y * E1y + S1z * E1z);
+
+        auto const b1 = invS1E1 * (S1x * Sx + S1y * Sy + S1z * Sz);
+        auto const b2 = invS1E1 * (S2x * D.x + S2y * D.y + S2z * D.z);
+
+        inside = (b1 + b2 <= 1) & (b1 >= 0) & (b2 >= 0);
+
+        return invS1E1 * (S2x * E2x + S2y * E2y + S2z * E2z);
+    }
+
+public:
+    void add(BasicTriangle<T> const& triangle, uint32_t shape)
+    {
+        auto const& v0 = triangle.get_v0();
+        auto const& E1 = triangle.get_E1();
+        auto const& E2 = triangle.get_E2();
+
+        this->push({ v0.x, v0.y, v0.z, E1.x, E1.y, E1.z, E2.x, E2.y, E2.z }, shape);
+    }
+
+    T find_intersection(BasicRay<T> const& ray, uint32_t begin, uint32_t count, T min, T max, BasicHit<T>& hit) const
+    {
+        using namespace Raytracer;
+
+        for (auto i = begin; i < begin + count; i += Packet::width<T>) {
+            RAYTRACER_STATS(Stats::count(Stats::TriangleTests, std::min<std::size_t>(Packet::width<T>, begin + count - i)));
+
+            auto inside = PacketMaskOf<T> {};
+            auto const time = solve(ray, i, inside);
+            auto const hits = ShapeArrays::first_lanes<T>(begin + count - i) & inside & (time > min) & (time < max);
+
+            if (Packet::any(hits))
+                max = this->closest(hits, time, i, max, hit);
+        }
+
+        return max;
+    }
+
+    bool intersects(BasicRay<T> const& ray, uint32_t begin, uint32_t count, T min, T max) const
+    {
+        using namespace Raytracer;
+
+        for (auto i = begin; i < begin + count; i += Packet::width<T>) {
+            RAYTRACER_STATS(Stats::count(Stats::TriangleTests, std::min<std::size_t>(Packet::width<T>, begin + count - i)));
+
+            auto inside = PacketMaskOf<T> {};
+            auto const time = solve(ray, i, inside);
+
+            if (Packet::any(ShapeArrays::first_lanes<T>(begin + count - i) & inside & (time > min) & (time < max)))
+                return true;
+        }
+
+        return false;
+    }
+
+    PacketMaskOf<T> find_intersection(BasicRayPacket<T> const& packet, PacketMaskOf<T> active, uint32_t begin, uint32_t count, T min, BasicPacketHit<T>& hit) const
+    {
+        auto hits = PacketMaskOf<T> {};
+
+        for (auto i = begin; i < begin + count; i++) {
+            RAYTRACER_STATS(Raytracer::Stats::count(Raytracer::Stats::TriangleTests, Raytracer::Stats::lanes(active)));
+
+            auto const closer = Raytracer::MollerTrumbore::find_intersection(
+                packet,
+                active,
+                { get(V0X, i), get(V0Y, i), get(V0Z, i) },
+                { get(E1X, i), get(E1Y, i), get(E1Z, i) },
+                { get(E2X, i), get(E2Y, i), get(E2Z, i) },
+                min,
+                hit.m_time);
+
+            this->record(closer, i, hit);
+            hits |= closer;
+        }
+
+        return hits;
+    }
+};
+
+using SphereArray = BasicSphereArray<double>;
+using PlaneArray = BasicPlaneArray<double>;
+using TriangleArray = BasicTriangleArray<double>;
@@ -3,23 +3,32 @@
 #include "../util/Ray.h"
 #include "Shape.h"
 
-class Sphere : public Shape {
+template <std::floating_point T>
+class BasicSphere : public BasicShape<T> {
 private:
-    Vec3<double> m_center;
-    double m_radius;
+    Vec3<T> m_center;
+    T m_radius;
 
 public:
-    Sphere(auto center, auto radius, auto material)
-        : Shape({ center - radius, center + radius }, material)
+    BasicSphere(auto center, auto radius, auto material)
+        : BasicShape<T>({ center - radius, center + radius }, material)
         , m_center(center)
         , m_radius(radius) {};
 
-    Vec3<double> get_normal(Vec3<double> point) const override
+    auto const& get_center() const { return m_center; }
+    auto get_radius() const { return m_radius; }
+
+    void translate(Vec3<T> const& offset) override
+    {
+        *this = BasicSphere(m_center + offset, m_radius, this->get_material());
+    }
+
+    Vec3<T> get_normal(Vec3<T> point) const override
     {
         return normalize(point - m_center);
     }
 
-    __attribute__((flatten)) double find_intersection(Ray ray, double min, double max) const override
+    __attribute__((flatten)) T find_intersection(BasicRay<T> const& ray, T min, T max) const override
     {
         auto oc = ray.get_origin() - m_center;
         auto b = dot(ray.get_direction(), oc);
@@ -40,4 +49,54 @@ public:
 
         return std::min(std::max(std::min(i0, i1), min), max);
     }
+
+    __attribute__((flatten)) PacketMaskOf<T> find_intersection(BasicRayPacket<T> const& packet, PacketMaskOf<T> active, T min, PacketOf<T>& times) const override
+    {
+        return find_intersection(packet, active, m_center, m_radius * m_radius, min, times);
+    }
+
+    // Packet kernel, shared with the sphere arrays of the scene
+    static PacketMaskOf<T> find_intersection(BasicRayPacket<T> const& packet, PacketMaskOf<T> active, Vec3<T> const& center, T radius2, T min, PacketOf<T>& times)
+    {
+        using namespace Raytracer;
+
+        PacketOf<T> oc[3];
+
+        for (auto axis = 0uz; axis < 3; axis++)
+            oc[axis] = packet.get_origin()[axis] - center[axis];
+
+        auto const b = Packet::dot(packet.get_direction(), oc);
+        auto const c = Packet::dot(oc, oc) - radius2;
+        auto const discriminant = b * b - c;
+
+        // Lanes with a negative discriminant produce NaN here and fail the comparisons below
+        auto const time = -(Packet::sqrt(discriminant) + b);
+        auto const hits = active & (discriminant >= 0) & (time > min) & (time < times);
+
+        times = hits ? time : times;
+
+        return hits;
+    }
+
+    __attribute__((flatten)) bool intersects(BasicRay<T> const& ray, T min, T max) const override
+    {
+        // Same test as find_intersection() on the nearest root -b - sqrt(discriminant), with both
+        // bounds compared in squared form so no square root is needed.
+        auto oc = ray.get_origin() - m_center;
+        auto b = dot(ray.get_direction(), oc);
+        auto c = dot(oc, oc) - m_radius * m_radius;
+
+        auto discriminant = b * b - c;
+
+        if (discriminant < 0)
+            return false;
+
+        auto const to_min = -b - min;
+        auto const to_max = -b - max;
+
+        return to_min > 0 && to_min * to_min > discriminant
+               && (to_max < 0 || discriminant > to_max * to_max);
+    }
 };
+
+using Sphere = BasicSphere<double>;
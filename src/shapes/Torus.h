@@ -1,131 +1,118 @@
 #pragma once
 
-#include <complex>
+#include <algorithm>
+#include <cmath>
 
+#include "../util/Polynomial.h"
 #include "../util/Ray.h"
+#include "../util/Stats.h"
 #include "Shape.h"
 
-#ifndef RAYTRACER_TORUS_THRESHOLD
-#    define RAYTRACER_TORUS_THRESHOLD 0.00001
-#endif
-
-#ifndef RAYTRACER_TORUS_EPSILON
-#    define RAYTRACER_TORUS_EPSILON RAYTRACER_TORUS_THRESHOLD
-#endif
-
-#ifndef RAYTRACER_TORUS_MAXIMUM_SEARCH
-// How many times should we apply Durand-Kerner before trying again with different points
-#    define RAYTRACER_TORUS_MAXIMUM_SEARCH 250'000
-#endif
-
-class Torus : public Shape {
+template <std::floating_point T>
+class BasicTorus : public BasicShape<T> {
 private:
-    Vec3<double> m_center;
-    double m_major_radius;
-    double m_minor_radius;
+    Vec3<T> m_center;
+    T m_major_radius;
+    T m_minor_radius;
 
 public:
-    Torus(auto center, auto major_radius, auto minor_radius, auto material)
-        : Shape({ center - std::abs(major_radius + minor_radius), center + std::abs(major_radius + minor_radius) }, material)
+    BasicTorus(auto center, auto major_radius, auto minor_radius, auto material)
+        : BasicShape<T>({ center - std::abs(major_radius + minor_radius), center + std::abs(major_radius + minor_radius) }, material)
         , m_center(center)
         , m_major_radius(major_radius)
         , m_minor_radius(minor_radius) {};
 
-    Vec3<double> get_normal(Vec3<double> point) const override
+    auto const& get_center() const { return m_center; }
+    auto get_major_radius() const { return m_major_radius; }
+    auto get_minor_radius() const { return m_minor_radius; }
+
+    void translate(Vec3<T> const& offset) override
+    {
+        *this = BasicTorus(m_center + offset, m_major_radius, m_minor_radius, this->get_material());
+    }
+
+    Vec3<T> get_normal(Vec3<T> point) const override
     {
         // Torii eqn. f(x, y, z) = (x^2 + y^2 + z^2 + R^2 - r^2)^2 - 4R^2 (x^2 + y^2)
         auto point_difference = point - m_center;
-        auto common = 1. - m_major_radius / std::sqrt(point_difference.x * point_difference.x + point_difference.y * point_difference.y);
+        auto common = 1 - m_major_radius / std::sqrt(point_difference.x * point_difference.x + point_difference.y * point_difference.y);
 
         // grad f is two times the Vec3 here, but we're normalizing so it doesn't matter
-        return normalize(Vec3<double> { point_difference.x * common,
-                                        point_difference.y * common,
-                                        point_difference.z });
+        return normalize(Vec3<T> { point_difference.x * common,
+                                   point_difference.y * common,
+                                   point_difference.z });
     }
 
-    __attribute__((flatten)) double find_smallest_real_quartic_root(std::complex<double> a, std::complex<double> b, std::complex<double> c, std::complex<double> d) const
+    __attribute__((flatten)) T find_intersection(BasicRay<T> const& ray, T min, T max) const override
     {
-        auto P = std::complex<double>(1.);
-        auto Q = std::complex<double>(.4, .9);
-        auto R = Q * Q;
-        auto S = R * Q;
-
-        std::complex<double> Phat, Qhat, Rhat, Shat;
-        double smallest_root = std::numeric_limits<double>::infinity();
-
-        auto static const is_within_threshold = [](auto const& a, auto const& b) {
-            return std::abs(a - b) < RAYTRACER_TORUS_THRESHOLD;
-        };
-        auto static const evaluate_polynomial = [&a, &b, &c, &d](auto const& x) {
-            return d + x * (c + x * (b + x * (a + x)));
-        };
-        auto static const get_next_point = [](auto const& x, auto const& p, auto const& q, auto const& r) {
-            return x - evaluate_polynomial(x) / ((x - p) * (x - q) * (x - r));
-        };
-
-        auto running = true;
-        while (running) {
-            for (auto i = 0; i < RAYTRACER_TORUS_MAXIMUM_SEARCH; i++) {
-                Phat = get_next_point(P, Q, R, S);
-                Qhat = get_next_point(Q, P, R, S);
-                Rhat = get_next_point(R, P, Q, S);
-                Shat = get_next_point(S, P, Q, R);
-
-                if (is_within_threshold(Phat, P)
-                    && is_within_threshold(Qhat, Q)
-                    && is_within_threshold(Rhat, R)
-                    && is_within_threshold(Shat, S)) {
-                    running = false;
-                    break;
-                }
-
-                P = Phat;
-                Q = Qhat;
-                R = Rhat;
-                S = Shat;
-            }
-
-            P = std::complex<double>(1.);
-            Q = std::complex<double>(static_cast<double>(rand()) / RAND_MAX, static_cast<double>(rand()) / RAND_MAX);
-            R = Q * Q;
-            S = R * Q;
-        }
-
-        if (std::abs(Phat.imag()) < RAYTRACER_TORUS_EPSILON)
-            smallest_root = std::min(smallest_root, Phat.real());
-
-        if (std::abs(Qhat.imag()) < RAYTRACER_TORUS_EPSILON)
-            smallest_root = std::min(smallest_root, Qhat.real());
-
-        if (std::abs(Rhat.imag()) < RAYTRACER_TORUS_EPSILON)
-            smallest_root = std::min(smallest_root, Rhat.real());
+        RAYTRACER_STATS(Raytracer::Stats::count(Raytracer::Stats::TorusTests));
 
-        if (std::abs(Shat.imag()) < RAYTRACER_TORUS_EPSILON)
-            smallest_root = std::min(smallest_root, Shat.real());
-
-        return smallest_root;
-    }
-
-    __attribute__((flatten)) double find_intersection(Ray ray, double min, double max) const override
-    {
         // From: http://cosinekitty.com/raytrace/chapter13_torus.html
+        // The quartic is badly conditioned, so it is set up and solved in double precision whatever T is.
+
+        auto const D = Vec3<double>(ray.get_direction());
+        auto const O = Vec3<double>(ray.get_origin()) - Vec3<double>(m_center);
+        auto const major_radius = static_cast<double>(m_major_radius);
+        auto const minor_radius = static_cast<double>(m_minor_radius);
+
+        // Clip the ray to the bounding sphere and to the slab |z| <= r the torus lies in. Rays that miss
+        // either cannot hit the torus, and moving the origin up to the clipped interval keeps the
+        // coefficients of the quartic small and well conditioned.
+        auto const outer_radius = major_radius + minor_radius;
+        auto const b = dot(D, O) / dot(D, D);
+        auto const discriminant = b * b - (dot(O, O) - outer_radius * outer_radius) / dot(D, D);
+
+        if (discriminant <= 0.)
+            return max;
+
+        auto const root = std::sqrt(discriminant);
+        auto enter = std::max(static_cast<double>(min), -b - root);
+        auto exit = std::min(static_cast<double>(max), root - b);
+
+        if (D.z != 0.) {
+            auto const z0 = (-minor_radius - O.z) / D.z;
+            auto const z1 = (minor_radius - O.z) / D.z;
+
+            enter = std::max(enter, std::min(z0, z1));
+            exit = std::min(exit, std::max(z0, z1));
+        } else if (std::abs(O.z) > minor_radius) {
+            return max;
+        }
 
-        auto const P = ray.get_origin() - m_center;
-        auto const T = 4. * m_major_radius * m_major_radius;
-        auto const G = T * (ray.get_direction().x * ray.get_direction().x + ray.get_direction().y * ray.get_direction().y);
-        auto const H = 2. * T * (P.x * ray.get_direction().x + P.y * ray.get_direction().y);
-        auto const I = T * (P.x * P.x + P.y * P.y);
-        auto const J = dot(ray.get_direction(), ray.get_direction());
-        auto const K = 2. * dot(ray.get_direction(), P);
-        auto const L = dot(P, P) + m_major_radius * m_major_radius - m_minor_radius * m_minor_radius;
+        if (enter >= exit)
+            return max;
+
+        auto const P = O + enter * D;
+        auto const S = 4. * major_radius * major_radius;
+        auto const G = S * (D.x * D.x + D.y * D.y);
+        auto const H = 2. * S * (P.x * D.x + P.y * D.y);
+        auto const I = S * (P.x * P.x + P.y * P.y);
+        auto const J = dot(D, D);
+        auto const K = 2. * dot(D, P);
+        auto const L = dot(P, P) + major_radius * major_radius - minor_radius * minor_radius;
         auto const M = 1. / (J * J);
 
-        auto root = find_smallest_real_quartic_root(
+        RAYTRACER_STATS(Raytracer::Stats::count(Raytracer::Stats::QuarticsSolved));
+
+        double roots[4];
+        auto const count = Raytracer::Polynomial::solve_quartic(
             M * (2 * J * K),
             M * (2 * J * L + K * K - G),
             M * (2 * K * L - H),
-            M * (L * L - I));
+            M * (L * L - I),
+            roots);
 
-        return std::min(std::max(root, min), max);
+        auto time = max;
+
+        for (auto i = 0uz; i < count; i++) {
+            auto const t = static_cast<T>(enter + roots[i]);
+
+            if (t > min && t < time)
+                time = t;
+        }
+
+        return time;
     }
 };
+
+using Torus = BasicTorus<double>;
@@ -1,70 +1,144 @@
 #pragma once
 
 #include "../util/Ray.h"
+#include "../util/RayPacket.h"
 #include "Shape.h"
 
-class Triangle : public Shape {
+namespace Raytracer {
+
+namespace MollerTrumbore {
+    /**
+     * Möller–Trumbore intersection algorithm for the triangle (v0, v0 + E1, v0 + E2)
+     *
+     * Shared by Triangle and TriangleMesh, which precompute the edges. Returns the time of intersection
+     * clamped to [min, max]; max if the ray misses the triangle.
+     */
+    template <std::floating_point T>
+    T inline find_intersection(BasicRay<T> const& ray, Vec3<T> const& v0, Vec3<T> const& E1, Vec3<T> const& E2, T min, T max)
+    {
+        auto S = ray.get_origin() - v0;
+        auto S1 = cross(ray.get_direction(), E2);
+        auto S2 = cross(S, E1);
+
+        auto invS1E1 = 1 / dot(S1, E1);
+
+        auto b1 = invS1E1 * dot(S1, S);
+        auto b2 = invS1E1 * dot(S2, ray.get_direction());
+
+        if (b1 + b2 > 1 || b1 < 0 || b2 < 0)
+            return max;
+
+        return std::min(std::max(min, invS1E1 * dot(S2, E2)), max);
+    }
+
+    // Packet version; updates times for the active lanes that hit inside of (min, times) and returns them.
+    template <std::floating_point T>
+    PacketMaskOf<T> inline find_intersection(BasicRayPacket<T> const& packet, PacketMaskOf<T> active, Vec3<T> const& v0, Vec3<T> const& E1, Vec3<T> const& E2, T min, PacketOf<T>& times)
+    {
+        auto const* D = packet.get_direction();
+
+        PacketOf<T> S[3];
+
+        for (auto axis = 0uz; axis < 3; axis++)
+            S[axis] = packet.get_origin()[axis] - v0[axis];
+
+        PacketOf<T> const S1[3] = {
+            D[1] * E2.z - D[2] * E2.y,
+            D[2] * E2.x - D[0] * E2.z,
+            D[0] * E2.y - D[1] * E2.x
+        };
+
+        PacketOf<T> const S2[3] = {
+            S[1] * E1.z - S[2] * E1.y,
+            S[2] * E1.x - S[0] * E1.z,
+            S[0] * E1.y - S[1] * E1.x
+        };
+
+        auto const invS1E1 = 1 / Packet::dot(S1, E1);
+
+        auto const b1 = invS1E1 * Packet::dot(S1, S);
+        auto const b2 = invS1E1 * Packet::dot(S2, D);
+        auto const time = invS1E1 * Packet::dot(S2, E2);
+
+        auto const hits = active & (b1 + b2 <= 1) & (b1 >= 0) & (b2 >= 0) & (time > min) & (time < times);
+
+        times = hits ? time : times;
+
+        return hits;
+    }
+}
+
+}
+
+template <std::floating_point T>
+class BasicTriangle : public BasicShape<T> {
 private:
-    Vec3<double> m_v0;
-    Vec3<double> m_v1;
-    Vec3<double> m_v2;
+    Vec3<T> m_v0;
+    Vec3<T> m_v1;
+    Vec3<T> m_v2;
 
-    Vec3<double> m_E1;
-    Vec3<double> m_E2;
+    Vec3<T> m_E1;
+    Vec3<T> m_E2;
 
-    Vec3<double> m_normal;
+    Vec3<T> m_normal;
 
 public:
-    Triangle(auto v0, auto v1, auto v2, auto material)
-        : Shape(material)
+    BasicTriangle(auto v0, auto v1, auto v2, auto material)
+        : BasicShape<T>(material)
         , m_v0(v0)
         , m_v1(v1)
         , m_v2(v2)
-        , m_E1(v1 - v0)
-        , m_E2(v2 - v0)
+        , m_E1(m_v1 - m_v0)
+        , m_E2(m_v2 - m_v0)
     {
-        auto min_point = Vec3<double> {
+        auto min_point = Vec3<T> {
             std::min(m_v0.x, std::min(m_v1.x, m_v2.x)),
             std::min(m_v0.y, std::min(m_v1.y, m_v2.y)),
             std::min(m_v0.z, std::min(m_v1.z, m_v2.z))
         };
 
-        auto max_point = Vec3<double> {
+        auto max_point = Vec3<T> {
             std::max(m_v0.x, std::max(m_v1.x, m_v2.x)),
             std::max(m_v0.y, std::max(m_v1.y, m_v2.y)),
             std::max(m_v0.z, std::max(m_v1.z, m_v2.z))
         };
 
-        set_bounding_box(std::move(BoundingBox(min_point, max_point)));
+        this->set_bounding_box(std::move(BasicBoundingBox<T>(min_point, max_point)));
         m_normal = normalize(cross(m_E1, m_E2));
 
         // If the determinant of the 3x3 matrix of (v0, v1, v2) is negative
         // then the points were given in anticlockwise order, and we need to
         // flip direction of the normal vector
-        if (dot(cross(m_v0, m_v1), m_v2) >= 0.)
-            m_normal *= -1.;
+        if (dot(cross(m_v0, m_v1), m_v2) >= 0)
+            m_normal *= T { -1 };
     }
 
-    Vec3<double> get_normal(Vec3<double>) const override
+    auto const& get_v0() const { return m_v0; }
+    auto const& get_v1() const { return m_v1; }
+    auto const& get_v2() const { return m_v2; }
+    auto const& get_E1() const { return m_E1; }
+    auto const& get_E2() const { return m_E2; }
+
+    // Remade from its vertices, since which way the normal faces depends on where they are
+    void translate(Vec3<T> const& offset) override
     {
-        return m_normal;
+        *this = BasicTriangle(m_v0 + offset, m_v1 + offset, m_v2 + offset, this->get_material());
     }
 
-    __attribute__((flatten)) double find_intersection(Ray ray, double min, double max) const override
+    Vec3<T> get_normal(Vec3<T>) const override
     {
-        // Möller–Trumbore intersection algorithm
-        auto S = ray.get_origin() - m_v0;
-        auto S1 = cross(ray.get_direction(), m_E2);
-        auto S2 = cross(S, m_E1);
-
-        auto invS1E1 = 1. / dot(S1, m_E1);
-
-        auto b1 = invS1E1 * dot(S1, S);
-        auto b2 = invS1E1 * dot(S2, ray.get_direction());
+        return m_normal;
+    }
 
-        if (b1 + b2 > 1. || b1 < 0. || b2 < 0.)
-            return max;
+    __attribute__((flatten)) T find_intersection(BasicRay<T> const& ray, T min, T max) const override
+    {
+        return Raytracer::MollerTrumbore::find_intersection(ray, m_v0, m_E1, m_E2, min, max);
+    }
 
-        return std::min(std::max(min, invS1E1 * dot(S2, m_E2)), max);
+    __attribute__((flatten)) PacketMaskOf<T> find_intersection(BasicRayPacket<T> const& packet, PacketMaskOf<T> active, T min, PacketOf<T>& times) const override
+    {
+        return Raytracer::MollerTrumbore::find_intersection(packet, active, m_v0, m_E1, m_E2, min, times);
     }
 };
+
+using Triangle = BasicTriangle<double>;
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <vector>
+
+#include "../util/BVH.h"
+#include "../util/Binary.h"
+#include "../util/Mesh.h"
+#include "../util/Ray.h"
+#include "../util/RayPacket.h"
+#include "../util/Stats.h"
+#include "Shape.h"
+#include "Triangle.h"
+
+/**
+ * Triangles sharing vertex and index buffers, with one material for the whole mesh
+ *
+ * The mesh is a single shape in the scene and keeps its own BVH over its triangles; the element reported by
+ * find_intersection() is the index of the triangle that was hit. Meshes with per-vertex normals are shaded
+ * smoothly, the others use the normal of every triangle as given by its winding order (counterclockwise
+ * seen from the front). The vertex data is kept in double precision as loaded, the faces are stored in T.
+ */
+template <std::floating_point T>
+class BasicTriangleMesh : public BasicShape<T> {
+private:
+    // Precomputed Möller–Trumbore data of a triangle
+    struct Face {
+        Vec3<T> m_v0;
+        Vec3<T> m_E1;
+        Vec3<T> m_E2;
+    };
+
+    MeshData m_mesh;
+    std::vector<Face> m_faces;
+    BasicBVH<T> m_bvh;
+
+    // Computes the faces and the bounding box of the mesh from its vertices, returning the box of every face
+    std::vector<BasicBoundingBox<T>> compute_faces()
+    {
+        auto boxes = std::vector<BasicBoundingBox<T>> {};
+        auto bounds = BasicBoundingBox<T>::empty();
+
+        m_faces.clear();
+        m_faces.reserve(m_mesh.get_triangle_count());
+        boxes.reserve(m_mesh.get_triangle_count());
+
+        for (auto i = 0uz; i < m_mesh.m_indices.size(); i += 3) {
+            auto const v0 = Vec3<T>(m_mesh.get_vertex(m_mesh.m_indices[i]));
+            auto const v1 = Vec3<T>(m_mesh.get_vertex(m_mesh.m_indices[i + 1]));
+            auto const v2 = Vec3<T>(m_mesh.get_vertex(m_mesh.m_indices[i + 2]));
+
+            auto box = BasicBoundingBox<T>::empty();
+
+            for (auto&& vertex : { v0, v1, v2 })
+                box.merge(vertex);
+
+            m_faces.push_back({ v0, v1 - v0, v2 - v0 });
+            boxes.push_back(box);
+            bounds.merge(box);
+        }
+
+        this->set_bounding_box(std::move(bounds));
+
+        return boxes;
+    }
+
+public:
+    BasicTriangleMesh(MeshData mesh, MaterialId material)
+        : BasicShape<T>(material)
+        , m_mesh(std::move(mesh))
+        , m_faces({})
+        , m_bvh({})
+    {
+        m_bvh.build(compute_faces());
+    }
+
+    // An empty mesh, to read() a snapshot into
+    explicit BasicTriangleMesh(MaterialId material)
+        : BasicShape<T>(material)
+        , m_mesh({})
+        , m_faces({})
+        , m_bvh({}) {};
+
+    auto const& get_mesh() const { return m_mesh; }
+
+    uint32_t get_element_count() const override { return static_cast<uint32_t>(m_faces.size()); }
+
+    // Moves the vertices and refits the BVH of the mesh, which keeps its shape
+    void translate(Vec3<T> const& offset) override
+    {
+        for (auto i = 0uz; i < m_mesh.get_vertex_count(); i++) {
+            m_mesh.m_x[i] += offset.x;
+            m_mesh.m_y[i] += offset.y;
+            m_mesh.m_z[i] += offset.z;
+        }
+
+        m_bvh.refit(compute_faces());
+    }
+
+    // Snapshot of the mesh with its faces and BVH, so that reading it back needs no build
+    void write(Raytracer::Binary::Writer& writer) const
+    {
+        for (auto* values : { &m_mesh.m_x, &m_mesh.m_y, &m_mesh.m_z, &m_mesh.m_nx, &m_mesh.m_ny, &m_mesh.m_nz })
+            writer.write(*values);
+
+        writer.write(m_mesh.m_indices);
+        writer.write(m_faces);
+        m_bvh.write(writer);
+        writer.write(this->get_bounding_box());
+    }
+
+    bool read(Raytracer::Binary::Reader& reader)
+    {
+        auto bounds = BasicBoundingBox<T> {};
+
+        for (auto* values : { &m_mesh.m_x, &m_mesh.m_y, &m_mesh.m_z, &m_mesh.m_nx, &m_mesh.m_ny, &m_mesh.m_nz })
+            reader.read(*values);
+
+        reader.read(m_mesh.m_indices);
+        reader.read(m_faces);
+        m_bvh.read(reader);
+
+        if (!reader.read(bounds) || m_faces.size() != m_mesh.get_triangle_count())
+            return false;
+
+        this->set_bounding_box(std::move(bounds));
+
+        return true;
+    }
+
+    Vec3<T> get_normal(Vec3<T> point) const override
+    {
+        return get_normal(point, 0);
+    }
+
+    Vec3<T> get_normal(Vec3<T> point, uint32_t element) const override
+    {
+        auto const& face = m_faces[element];
+
+        if (!m_mesh.has_normals())
+            return normalize(cross(face.m_E1, face.m_E2));
+
+        // Interpolate the vertex normals with the barycentric coordinates of the point
+        auto const P = point - face.m_v0;
+
+        auto const d00 = dot(face.m_E1, face.m_E1);
+        auto const d01 = dot(face.m_E1, face.m_E2);
+        auto const d11 = dot(face.m_E2, face.m_E2);
+        auto const d20 = dot(P, face.m_E1);
+        auto const d21 = dot(P, face.m_E2);
+        auto const inverse_denominator = 1 / (d00 * d11 - d01 * d01);
+
+        auto const b1 = (d11 * d20 - d01 * d21) * inverse_denominator;
+        auto const b2 = (d00 * d21 - d01 * d20) * inverse_denominator;
+
+        auto const* indices = &m_mesh.m_indices[3 * element];
+
+        return normalize(
+            (1 - b1 - b2) * Vec3<T>(m_mesh.get_normal(indices[0]))
+            + b1 * Vec3<T>(m_mesh.get_normal(indices[1]))
+            + b2 * Vec3<T>(m_mesh.get_normal(indices[2])));
+    }
+
+    __attribute__((flatten)) T find_intersection(BasicRay<T> const& ray, T min, T max) const override
+    {
+        auto element = 0u;
+
+        return find_intersection(ray, min, max, element);
+    }
+
+    __attribute__((flatten)) T find_intersection(BasicRay<T> const& ray, T min, T max, uint32_t& element) const override
+    {
+        return m_bvh.traverse(ray, min, max, [&](auto index, T max) {
+            auto const& face = m_faces[index];
+
+            RAYTRACER_STATS(Raytracer::Stats::count(Raytracer::Stats::MeshTriangleTests));
+
+            auto const time = Raytracer::MollerTrumbore::find_intersection(ray, face.m_v0, face.m_E1, face.m_E2, min, max);
+
+            if (time > min && time < max)
+                element = index;
+
+            return time;
+        });
+    }
+
+    __attribute__((flatten)) PacketMaskOf<T> find_intersection(BasicRayPacket<T> const& packet, PacketMaskOf<T> active, T min, PacketOf<T>& times) const override
+    {
+        auto elements = PacketIndexOf<T> {};
+
+        return find_intersection(packet, active, min, times, elements);
+    }
+
+    __attribute__((flatten)) PacketMaskOf<T> find_intersection(BasicRayPacket<T> const& packet, PacketMaskOf<T> active, T min, PacketOf<T>& times, PacketIndexOf<T>& elements) const override
+    {
+        auto hits = PacketMaskOf<T> {};
+
+        m_bvh.traverse(packet, active, min, times, [&](auto index, PacketMaskOf<T> mask) {
+            auto const& face = m_faces[index];
+
+            RAYTRACER_STATS(Raytracer::Stats::count(Raytracer::Stats::MeshTriangleTests, Raytracer::Stats::lanes(mask)));
+
+            auto const closer = Raytracer::MollerTrumbore::find_intersection(packet, mask, face.m_v0, face.m_E1, face.m_E2, min, times);
+
+            elements = closer ? static_cast<Raytracer::Packet::Integer<T>>(index) : elements;
+            hits |= closer;
+        });
+
+        return hits;
+    }
+
+    __attribute__((flatten)) bool intersects(BasicRay<T> const& ray, T min, T max) const override
+    {
+        return m_bvh.occluded(ray, min, max, [&](auto index) {
+            auto const& face = m_faces[index];
+
+            RAYTRACER_STATS(Raytracer::Stats::count(Raytracer::Stats::MeshTriangleTests));
+
+            auto const time = Raytracer::MollerTrumbore::find_intersection(ray, face.m_v0, face.m_E1, face.m_E2, min, max);
+
+            return time > min && time < max;
+        });
+    }
+};
+
+using TriangleMesh = BasicTriangleMesh<double>;
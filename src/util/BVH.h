@@ -0,0 +1,545 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "Binary.h"
+#include "BoundingBox.h"
+#include "Ray.h"
+#include "RayPacket.h"
+#include "Stats.h"
+#include "Vec.h"
+
+#ifndef RAYTRACER_BVH_BINS
+#    define RAYTRACER_BVH_BINS 16
+#endif
+
+#ifndef RAYTRACER_BVH_MAX_LEAF_SIZE
+#    define RAYTRACER_BVH_MAX_LEAF_SIZE 4
+#endif
+
+#ifndef RAYTRACER_BVH_TRAVERSAL_COST
+// Cost of visiting an interior node relative to a single primitive intersection
+#    define RAYTRACER_BVH_TRAVERSAL_COST 1.
+#endif
+
+#ifndef RAYTRACER_BVH_STACK_SIZE
+#    define RAYTRACER_BVH_STACK_SIZE 64
+#endif
+
+template <std::floating_point T>
+class BasicBVH {
+public:
+    using BoundingBox = BasicBoundingBox<T>;
+    using Ray = BasicRay<T>;
+    using RayPacket = BasicRayPacket<T>;
+
+    struct Node {
+        BoundingBox m_bounds;
+
+        // Leaves: index of the first entry in m_indices.
+        // Interior nodes: index of the second child, the first child immediately follows its parent.
+        uint32_t m_offset;
+        uint16_t m_count; // Number of primitives, zero for interior nodes
+        uint16_t m_axis;  // Split axis, used to order traversal
+
+        bool is_leaf() const { return m_count != 0; }
+    };
+
+    // A node index that is no node
+    static constexpr uint32_t no_node = std::numeric_limits<uint32_t>::max();
+
+private:
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_indices;
+
+    struct Primitive {
+        BoundingBox m_bounds;
+        Vec3<T> m_centroid;
+        uint32_t m_index;
+    };
+
+    uint32_t build_recursive(std::vector<Primitive>& primitives, std::size_t begin, std::size_t end, std::size_t depth)
+    {
+        auto const node_index = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.push_back({});
+
+        auto bounds = BoundingBox::empty();
+        auto centroid_bounds = BoundingBox::empty();
+
+        for (auto i = begin; i < end; i++) {
+            bounds.merge(primitives[i].m_bounds);
+            centroid_bounds.merge(primitives[i].m_centroid);
+        }
+
+        auto const count = end - begin;
+
+        auto make_leaf = [&]() {
+            m_nodes[node_index] = {
+                .m_bounds = bounds,
+                .m_offset = static_cast<uint32_t>(m_indices.size()),
+                .m_count = static_cast<uint16_t>(count),
+                .m_axis = 0
+            };
+
+            for (auto i = begin; i < end; i++)
+                m_indices.push_back(primitives[i].m_index);
+
+            return node_index;
+        };
+
+        // Traversal keeps at most one pending node per level on its stack
+        if (count == 1 || depth + 1 >= RAYTRACER_BVH_STACK_SIZE)
+            return make_leaf();
+
+        // Split along the axis with the largest centroid extent
+        auto const extent = centroid_bounds.get_extent();
+        auto axis = 0uz;
+
+        if (extent.y > extent[axis])
+            axis = 1;
+
+        if (extent.z > extent[axis])
+            axis = 2;
+
+        auto const axis_min = centroid_bounds.get_min()[axis];
+        auto const axis_extent = extent[axis];
+
+        // All centroids coincide; nothing to split on
+        if (axis_extent <= 0) {
+            if (count <= RAYTRACER_BVH_MAX_LEAF_SIZE)
+                return make_leaf();
+
+            auto const middle = begin + count / 2;
+            return split(primitives, begin, middle, end, depth, node_index, bounds, axis);
+        }
+
+        struct Bin {
+            BoundingBox m_bounds = BoundingBox::empty();
+            std::size_t m_count = 0;
+        };
+
+        auto bins = std::array<Bin, RAYTRACER_BVH_BINS> {};
+
+        auto get_bin = [&](Primitive const& primitive) {
+            auto const bin = static_cast<std::size_t>(RAYTRACER_BVH_BINS * ((primitive.m_centroid[axis] - axis_min) / axis_extent));
+            return std::min(bin, bins.size() - 1);
+        };
+
+        for (auto i = begin; i < end; i++) {
+            auto& bin = bins[get_bin(primitives[i])];
+
+            bin.m_bounds.merge(primitives[i].m_bounds);
+            bin.m_count++;
+        }
+
+        // Sweep from the right to get the area and count of every suffix, then from the left to evaluate
+        // the surface area heuristic at every bin boundary.
+        auto right_area = std::array<T, RAYTRACER_BVH_BINS> {};
+        auto right_count = std::array<std::size_t, RAYTRACER_BVH_BINS> {};
+        auto accumulated = BoundingBox::empty();
+        auto accumulated_count = 0uz;
+
+        for (auto i = bins.size() - 1; i > 0; i--) {
+            accumulated.merge(bins[i].m_bounds);
+            accumulated_count += bins[i].m_count;
+
+            right_area[i] = accumulated.surface_area();
+            right_count[i] = accumulated_count;
+        }
+
+        auto best_cost = std::numeric_limits<T>::infinity();
+        auto best_split = 0uz;
+
+        accumulated = BoundingBox::empty();
+        accumulated_count = 0;
+
+        for (auto i = 0uz; i < bins.size() - 1; i++) {
+            accumulated.merge(bins[i].m_bounds);
+            accumulated_count += bins[i].m_count;
+
+            auto const cost = accumulated_count * accumulated.surface_area() + right_count[i + 1] * right_area[i + 1];
+
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_split = i;
+            }
+        }
+
+        auto const parent_area = bounds.surface_area();
+        auto const leaf_cost = static_cast<T>(count);
+        auto const split_cost = static_cast<T>(RAYTRACER_BVH_TRAVERSAL_COST) + (parent_area > 0 ? best_cost / parent_area : leaf_cost);
+
+        if (count <= RAYTRACER_BVH_MAX_LEAF_SIZE && leaf_cost <= split_cost)
+            return make_leaf();
+
+        auto const middle = std::partition(
+            primitives.begin() + begin,
+            primitives.begin() + end,
+            [&](auto const& primitive) { return get_bin(primitive) <= best_split; });
+
+        return split(primitives, begin, middle - primitives.begin(), end, depth, node_index, bounds, axis);
+    }
+
+    uint32_t split(std::vector<Primitive>& primitives, std::size_t begin, std::size_t middle, std::size_t end, std::size_t depth, uint32_t node_index, BoundingBox const& bounds, std::size_t axis)
+    {
+        // Binning can put every primitive on one side; fall back to a median split
+        if (middle == begin || middle == end) {
+            middle = begin + (end - begin) / 2;
+
+            std::nth_element(
+                primitives.begin() + begin,
+                primitives.begin() + middle,
+                primitives.begin() + end,
+                [axis](auto const& a, auto const& b) { return a.m_centroid[axis] < b.m_centroid[axis]; });
+        }
+
+        build_recursive(primitives, begin, middle, depth + 1);
+        auto const second_child = build_recursive(primitives, middle, end, depth + 1);
+
+        m_nodes[node_index] = {
+            .m_bounds = bounds,
+            .m_offset = second_child,
+            .m_count = 0,
+            .m_axis = static_cast<uint16_t>(axis)
+        };
+
+        return node_index;
+    }
+
+public:
+    BasicBVH()
+        : m_nodes({})
+        , m_indices({}) {};
+
+    void build(std::vector<BoundingBox> const& boxes)
+    {
+        m_nodes.clear();
+        m_indices.clear();
+
+        if (boxes.empty())
+            return;
+
+        auto primitives = std::vector<Primitive> {};
+        primitives.reserve(boxes.size());
+
+        for (auto i = 0uz; i < boxes.size(); i++)
+            primitives.push_back({ boxes[i], boxes[i].get_centroid(), static_cast<uint32_t>(i) });
+
+        m_nodes.reserve(2 * boxes.size());
+        m_indices.reserve(boxes.size());
+
+        build_recursive(primitives, 0, primitives.size(), 0);
+    }
+
+    /**
+     * Updates the bounds of every node for new bounds of the same primitives, keeping the hierarchy as built.
+     * Much cheaper than build(), but traversal gets slower the further the primitives move from where they
+     * were when it was built.
+     */
+    void refit(std::vector<BoundingBox> const& boxes)
+    {
+        // Children come after their parents
+        for (auto i = m_nodes.size(); i-- > 0;) {
+            auto& node = m_nodes[i];
+
+            node.m_bounds = BoundingBox::empty();
+
+            if (node.is_leaf()) {
+                for (auto j = node.m_offset; j < node.m_offset + node.m_count; j++)
+                    node.m_bounds.merge(boxes[m_indices[j]]);
+            } else {
+                node.m_bounds.merge(m_nodes[i + 1].m_bounds);
+                node.m_bounds.merge(m_nodes[node.m_offset].m_bounds);
+            }
+        }
+    }
+
+    auto const& get_nodes() const { return m_nodes; }
+    auto const& get_indices() const { return m_indices; }
+
+    // Snapshot of the built hierarchy, read back instead of building it again
+    void write(Raytracer::Binary::Writer& writer) const
+    {
+        writer.write(m_nodes);
+        writer.write(m_indices);
+    }
+
+    bool read(Raytracer::Binary::Reader& reader)
+    {
+        return reader.read(m_nodes) && reader.read(m_indices);
+    }
+
+    /**
+     * Closest-hit traversal
+     *
+     * Visits leaves front to back and calls intersect(index, max) for every primitive in them, which returns
+     * the time of intersection if it is inside of (min, max). The search interval shrinks to the closest hit
+     * found so far so subtrees behind it are culled.
+     *
+     * Returns the time of the closest intersection, or max if there was none.
+     */
+    template <typename F>
+    __attribute__((flatten)) T traverse(Ray const& ray, T min, T max, F&& intersect) const
+    {
+        return traverse_leaves(ray, min, max, [&](uint32_t first, uint32_t count, T max) {
+            for (auto i = first; i < first + count; i++) {
+                auto const time = intersect(m_indices[i], max);
+
+                if (time > min && time < max)
+                    max = time;
+            }
+
+            return max;
+        });
+    }
+
+    /**
+     * As above, calling intersect(first, count, max) once per leaf with the range of m_indices it holds, so
+     * that the primitives of a leaf can be tested together. It returns the time of the closest intersection
+     * in the leaf inside of (min, max), or max.
+     */
+    template <typename F>
+    __attribute__((flatten)) T traverse_leaves(Ray const& ray, T min, T max, F&& intersect) const
+    {
+        if (m_nodes.empty())
+            return max;
+
+        auto const inverse_direction = T { 1 } / ray.get_direction();
+        auto const negative = std::array<bool, 3> {
+            inverse_direction.x < 0,
+            inverse_direction.y < 0,
+            inverse_direction.z < 0
+        };
+
+        uint32_t stack[RAYTRACER_BVH_STACK_SIZE];
+        auto stack_size = 0uz;
+        auto node_index = 0u;
+
+        while (true) {
+            auto const& node = m_nodes[node_index];
+
+            RAYTRACER_STATS(Raytracer::Stats::count(Raytracer::Stats::BoxTests));
+
+            if (node.m_bounds.find_intersection(ray, inverse_direction, min, max)) {
+                if (node.is_leaf()) {
+                    auto const time = intersect(node.m_offset, node.m_count, max);
+
+                    if (time > min && time < max)
+                        max = time;
+                } else if (negative[node.m_axis]) {
+                    // Ray travels towards the negative side of the split; visit the second child first
+                    stack[stack_size++] = node_index + 1;
+                    node_index = node.m_offset;
+                    continue;
+                } else {
+                    stack[stack_size++] = node.m_offset;
+                    node_index++;
+                    continue;
+                }
+            }
+
+            if (!stack_size)
+                break;
+
+            node_index = stack[--stack_size];
+        }
+
+        return max;
+    }
+
+    /**
+     * Closest-hit traversal for a packet of rays
+     *
+     * A node is visited when any active lane enters it before its own closest hit; the children are ordered
+     * by the direction of the first lane, as the rays of a packet are expected to be coherent.
+     * intersect(index, mask) is called with the lanes that reached the leaf and updates max.
+     */
+    template <typename F>
+    __attribute__((flatten)) void traverse(RayPacket const& packet, PacketMaskOf<T> active, T min, PacketOf<T>& max, F&& intersect) const
+    {
+        traverse_leaves(packet, active, min, max, [&](uint32_t first, uint32_t count, PacketMaskOf<T> mask) {
+            for (auto i = first; i < first + count; i++)
+                intersect(m_indices[i], mask);
+        });
+    }
+
+    // As above, calling intersect(first, count, mask) once per leaf with the range of m_indices it holds.
+    template <typename F>
+    __attribute__((flatten)) void traverse_leaves(RayPacket const& packet, PacketMaskOf<T> active, T min, PacketOf<T>& max, F&& intersect) const
+    {
+        if (m_nodes.empty())
+            return;
+
+        auto const negative = std::array<bool, 3> {
+            packet.get_inverse_direction()[0][0] < 0,
+            packet.get_inverse_direction()[1][0] < 0,
+            packet.get_inverse_direction()[2][0] < 0
+        };
+
+        uint32_t stack[RAYTRACER_BVH_STACK_SIZE];
+        auto stack_size = 0uz;
+        auto node_index = 0u;
+
+        while (true) {
+            auto const& node = m_nodes[node_index];
+            auto const mask = active & node.m_bounds.find_intersection(packet, min, max);
+
+            RAYTRACER_STATS(Raytracer::Stats::count(Raytracer::Stats::BoxTests, Raytracer::Stats::lanes(active)));
+
+            if (Raytracer::Packet::any(mask)) {
+                if (node.is_leaf()) {
+                    intersect(node.m_offset, node.m_count, mask);
+                } else if (negative[node.m_axis]) {
+                    stack[stack_size++] = node_index + 1;
+                    node_index = node.m_offset;
+                    continue;
+                } else {
+                    stack[stack_size++] = node.m_offset;
+                    node_index++;
+                    continue;
+                }
+            }
+
+            if (!stack_size)
+                break;
+
+            node_index = stack[--stack_size];
+        }
+    }
+
+    /**
+     * Any-hit traversal
+     *
+     * Returns as soon as intersects(index) reports an intersection inside of (min, max) for any primitive.
+     */
+    template <typename F>
+    __attribute__((flatten)) bool occluded(Ray const& ray, T min, T max, F&& intersects) const
+    {
+        return occluded_leaves(ray, min, max, [&](uint32_t first, uint32_t count) {
+            for (auto i = first; i < first + count; i++)
+                if (intersects(m_indices[i]))
+                    return true;
+
+            return false;
+        });
+    }
+
+    // As above, calling intersects(first, count) once per leaf with the range of m_indices it holds.
+    template <typename F>
+    __attribute__((flatten)) bool occluded_leaves(Ray const& ray, T min, T max, F&& intersects) const
+    {
+        auto occluder = no_node;
+
+        return occluded_leaves(ray, min, max, occluder, intersects);
+    }
+
+    /**
+     * As above, testing the leaf node occluder before the others
+     *
+     * If a leaf reports an intersection, occluder is set to its node, so that passing it along with the next
+     * ray likely to be blocked by the same primitives (say, the shadow ray of the next pixel towards the same
+     * light) saves the traversal. Its bounds are tested like those of any other node, as primitive tests are
+     * not reliable far outside of them. Nodes that are not leaves, or no_node, are ignored.
+     */
+    template <typename F>
+    __attribute__((flatten)) bool occluded_leaves(Ray const& ray, T min, T max, uint32_t& occluder, F&& intersects) const
+    {
+        if (m_nodes.empty())
+            return false;
+
+        auto const inverse_direction = T { 1 } / ray.get_direction();
+
+        if (occluder < m_nodes.size() && m_nodes[occluder].is_leaf()) {
+            auto const& node = m_nodes[occluder];
+
+            RAYTRACER_STATS(Raytracer::Stats::count(Raytracer::Stats::BoxTests));
+
+            if (node.m_bounds.find_intersection(ray, inverse_direction, min, max) && intersects(node.m_offset, node.m_count)) {
+                RAYTRACER_STATS(Raytracer::Stats::count(Raytracer::Stats::OccluderCacheHits));
+                return true;
+            }
+
+            RAYTRACER_STATS(Raytracer::Stats::count(Raytracer::Stats::OccluderCacheMisses));
+        }
+
+        uint32_t stack[RAYTRACER_BVH_STACK_SIZE];
+        auto stack_size = 0uz;
+        auto node_index = 0u;
+
+        while (true) {
+            auto const& node = m_nodes[node_index];
+
+            RAYTRACER_STATS(Raytracer::Stats::count(Raytracer::Stats::BoxTests));
+
+            if (node.m_bounds.find_intersection(ray, inverse_direction, min, max)) {
+                if (!node.is_leaf()) {
+                    stack[stack_size++] = node.m_offset;
+                    node_index++;
+                    continue;
+                }
+
+                // The occluder has been tested already
+                if (node_index != occluder && intersects(node.m_offset, node.m_count)) {
+                    occluder = node_index;
+                    return true;
+                }
+            }
+
+            if (!stack_size)
+                break;
+
+            node_index = stack[--stack_size];
+        }
+
+        return false;
+    }
+
+    // Calls visit(index) for every primitive whose bounds contain the point.
+    template <typename F>
+    void query(Vec3<T> const& point, F&& visit) const
+    {
+        if (m_nodes.empty())
+            return;
+
+        auto contains = [&](BoundingBox const& box) {
+            auto inside = true;
+
+            point.for_each_const([&](auto const& a, auto idx) {
+                inside &= a >= box.get_min()[idx] && a <= box.get_max()[idx];
+            });
+
+            return inside;
+        };
+
+        uint32_t stack[RAYTRACER_BVH_STACK_SIZE];
+        auto stack_size = 0uz;
+        auto node_index = 0u;
+
+        while (true) {
+            auto const& node = m_nodes[node_index];
+
+            if (contains(node.m_bounds)) {
+                if (!node.is_leaf()) {
+                    stack[stack_size++] = node.m_offset;
+                    node_index++;
+                    continue;
+                }
+
+                for (auto i = node.m_offset; i < node.m_offset + node.m_count; i++)
+                    visit(m_indices[i]);
+            }
+
+            if (!stack_size)
+                break;
+
+            node_index = stack[--stack_size];
+        }
+    }
+};
+
+using BVH = BasicBVH<double>;
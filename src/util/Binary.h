@@ -0,0 +1,146 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Raw binary snapshots of the data structures of a scene, for the scene cache and render workers
+ *
+ * Values and arrays of trivially copyable types are written as their bytes in memory, so reading them back is
+ * a copy; arrays are preceded by their length. Snapshots are only meant to be read on the machine (and by the
+ * build) that wrote them.
+ */
+
+namespace Raytracer {
+
+namespace Binary {
+    template <typename T>
+    concept Raw = std::is_trivially_copyable_v<T>;
+
+    class Writer {
+    private:
+        std::vector<uint8_t> m_data;
+
+    public:
+        Writer()
+            : m_data({}) {};
+
+        void write_bytes(void const* data, std::size_t size)
+        {
+            auto const* bytes = static_cast<uint8_t const*>(data);
+            m_data.insert(m_data.end(), bytes, bytes + size);
+        }
+
+        template <Raw T>
+        void write(T const& value) { write_bytes(&value, sizeof(T)); }
+
+        template <Raw T>
+        void write(std::vector<T> const& values)
+        {
+            write(static_cast<uint64_t>(values.size()));
+            write_bytes(values.data(), values.size() * sizeof(T));
+        }
+
+        template <Raw T, std::size_t N>
+        void write(std::array<std::vector<T>, N> const& arrays)
+        {
+            for (auto&& values : arrays)
+                write(values);
+        }
+
+        void write_string(std::string_view string)
+        {
+            write(static_cast<uint64_t>(string.size()));
+            write_bytes(string.data(), string.size());
+        }
+
+        std::vector<uint8_t> const& get_data() const { return m_data; }
+
+        // Writes everything in a single call; returns false if the file could not be written.
+        bool save(std::string const& path) const
+        {
+            auto* file = std::fopen(path.c_str(), "wb");
+
+            if (!file)
+                return false;
+
+            auto ok = std::fwrite(m_data.data(), 1, m_data.size(), file) == m_data.size();
+
+            return std::fclose(file) == 0 && ok;
+        }
+    };
+
+    // Reads from memory, usually a mapped file. Reading past the end fails, as do all reads after it.
+    class Reader {
+    private:
+        std::string_view m_data;
+        std::size_t m_position;
+        bool m_ok;
+
+    public:
+        Reader(std::string_view data)
+            : m_data(data)
+            , m_position(0)
+            , m_ok(true) {};
+
+        bool ok() const { return m_ok; }
+        bool at_end() const { return m_position == m_data.size(); }
+
+        bool read_bytes(void* data, std::size_t size)
+        {
+            if (!m_ok || size > m_data.size() - m_position)
+                return m_ok = false;
+
+            std::memcpy(data, m_data.data() + m_position, size);
+            m_position += size;
+
+            return true;
+        }
+
+        template <Raw T>
+        bool read(T& value) { return read_bytes(&value, sizeof(T)); }
+
+        template <Raw T>
+        bool read(std::vector<T>& values)
+        {
+            auto size = uint64_t {};
+
+            if (!read(size) || size > (m_data.size() - m_position) / sizeof(T))
+                return m_ok = false;
+
+            values.resize(size);
+
+            return read_bytes(values.data(), size * sizeof(T));
+        }
+
+        template <Raw T, std::size_t N>
+        bool read(std::array<std::vector<T>, N>& arrays)
+        {
+            for (auto&& values : arrays)
+                read(values);
+
+            return m_ok;
+        }
+
+        bool read_string(std::string& string)
+        {
+            auto size = uint64_t {};
+
+            if (!read(size) || size > m_data.size() - m_position)
+                return m_ok = false;
+
+            string.assign(m_data.data() + m_position, size);
+            m_position += size;
+
+            return true;
+        }
+    };
+}
+
+}
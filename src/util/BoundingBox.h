@@ -1,38 +1,114 @@
 #pragma once
 
+#include <cmath>
+#include <concepts>
 #include <limits>
 
 #include "Ray.h"
+#include "RayPacket.h"
 #include "Vec.h"
 
-class BoundingBox {
+template <std::floating_point T>
+class BasicBoundingBox {
 private:
-    Vec3<double> m_min;
-    Vec3<double> m_max;
+    Vec3<T> m_min;
+    Vec3<T> m_max;
 
 public:
-    BoundingBox()
-        : m_min(Vec3<double>(-std::numeric_limits<double>::infinity()))
-        , m_max(Vec3<double>(std::numeric_limits<double>::infinity())) {};
+    BasicBoundingBox()
+        : m_min(Vec3<T>(-std::numeric_limits<T>::infinity()))
+        , m_max(Vec3<T>(std::numeric_limits<T>::infinity())) {};
 
-    BoundingBox(auto min, auto max)
+    BasicBoundingBox(auto min, auto max)
         : m_min(min)
         , m_max(max) {};
 
-    __attribute__((flatten)) bool find_intersection(Ray const& ray) const
+    static BasicBoundingBox empty()
     {
-        auto min = (m_min - ray.get_origin()) / ray.get_direction();
-        auto max = (m_max - ray.get_origin()) / ray.get_direction();
+        return { Vec3<T>(std::numeric_limits<T>::infinity()),
+                 Vec3<T>(-std::numeric_limits<T>::infinity()) };
+    }
+
+    auto const& get_min() const { return m_min; }
+    auto const& get_max() const { return m_max; }
+
+    auto get_centroid() const { return T { .5 } * (m_min + m_max); }
+    auto get_extent() const { return m_max - m_min; }
+
+    bool is_bounded() const
+    {
+        auto bounded = true;
+
+        m_min.for_each_const([&](auto const& a, auto idx) {
+            bounded &= std::isfinite(a) && std::isfinite(m_max[idx]);
+        });
+
+        return bounded;
+    }
 
-        auto tmin = std::min(min.x, max.x);
-        auto tmax = std::max(min.x, max.x);
+    T surface_area() const
+    {
+        auto extent = get_extent();
+
+        if (extent.x < 0 || extent.y < 0 || extent.z < 0)
+            return 0;
 
-        tmin = std::max(tmin, std::min(std::min(min.y, max.y), tmax));
-        tmax = std::max(tmax, std::max(std::max(min.y, max.y), tmin));
+        return 2 * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+    }
 
-        tmin = std::max(tmin, std::min(std::min(min.z, max.z), tmax));
-        tmax = std::max(tmax, std::max(std::max(min.z, max.z), tmin));
+    void merge(BasicBoundingBox const& other)
+    {
+        m_min.for_each([&](auto& a, auto idx) { a = std::min(a, other.m_min[idx]); });
+        m_max.for_each([&](auto& a, auto idx) { a = std::max(a, other.m_max[idx]); });
+    }
 
-        return tmax > std::max(tmin, 0.);
+    void merge(Vec3<T> const& point)
+    {
+        m_min.for_each([&](auto& a, auto idx) { a = std::min(a, point[idx]); });
+        m_max.for_each([&](auto& a, auto idx) { a = std::max(a, point[idx]); });
+    }
+
+    __attribute__((flatten)) bool find_intersection(BasicRay<T> const& ray, Vec3<T> const& inverse_direction, T min, T max) const
+    {
+        // Slab test; the slab times are always the second argument to std::min/std::max so that the
+        // NaN produced by 0 * inf (origin lying on a slab with a parallel ray) is discarded.
+        auto t0 = (m_min - ray.get_origin()) * inverse_direction;
+        auto t1 = (m_max - ray.get_origin()) * inverse_direction;
+
+        auto tmin = min;
+        auto tmax = max;
+
+        t0.for_each_const([&](auto const& a, auto idx) {
+            tmin = std::max(tmin, std::min(a, t1[idx]));
+            tmax = std::min(tmax, std::max(a, t1[idx]));
+        });
+
+        return tmin <= tmax;
+    }
+
+    // Lanes of the packet whose ray enters the box inside of [min, max]
+    __attribute__((flatten)) PacketMaskOf<T> find_intersection(BasicRayPacket<T> const& packet, T min, PacketOf<T> const& max) const
+    {
+        using namespace Raytracer;
+
+        auto tmin = PacketOf<T> {} + min;
+        auto tmax = max;
+
+        for (auto axis = 0uz; axis < 3; axis++) {
+            auto const t0 = (m_min[axis] - packet.get_origin()[axis]) * packet.get_inverse_direction()[axis];
+            auto const t1 = (m_max[axis] - packet.get_origin()[axis]) * packet.get_inverse_direction()[axis];
+
+            tmin = Packet::max(tmin, Packet::min(t0, t1));
+            tmax = Packet::min(tmax, Packet::max(t0, t1));
+        }
+
+        return tmin <= tmax;
+    }
+
+    __attribute__((flatten)) bool find_intersection(BasicRay<T> const& ray) const
+    {
+        return find_intersection(ray, T { 1 } / ray.get_direction(), 0, std::numeric_limits<T>::infinity());
     }
 };
+
+using BoundingBox = BasicBoundingBox<double>;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <concepts>
+
 #ifndef RAYTRACER_MAX_RECURSION_DEPTH
 #    define RAYTRACER_MAX_RECURSION_DEPTH 8
 #endif
@@ -12,6 +14,37 @@
 #    define RAYTRACER_REFLECTIVITY_EPSILON RAYTRACER_EPSILON
 #endif
 
+#ifndef RAYTRACER_FLOAT_EPSILON
+// Used instead of RAYTRACER_EPSILON when rendering in single precision. Secondary rays start this far from the
+// surface they leave, which has to exceed the rounding error of the hit point; that error grows with the
+// distance from the origin by about 1e-7 per unit in single precision against 1e-16 in double.
+#    define RAYTRACER_FLOAT_EPSILON 0.01
+#endif
+
+#ifndef RAYTRACER_FLOAT_REFLECTIVITY_EPSILON
+#    define RAYTRACER_FLOAT_REFLECTIVITY_EPSILON RAYTRACER_FLOAT_EPSILON
+#endif
+
 #ifndef MULTITHREAD_WORKERS
-#    define MULTITHREAD_WORKERS 12
+// Default number of render threads; 0 uses one per hardware thread
+#    define MULTITHREAD_WORKERS 0
 #endif
+
+namespace Raytracer {
+
+namespace Config {
+    // The epsilons above for the precision of a renderer
+    template <std::floating_point T>
+    constexpr T epsilon = static_cast<T>(RAYTRACER_EPSILON);
+
+    template <>
+    constexpr float epsilon<float> = static_cast<float>(RAYTRACER_FLOAT_EPSILON);
+
+    template <std::floating_point T>
+    constexpr T reflectivity_epsilon = static_cast<T>(RAYTRACER_REFLECTIVITY_EPSILON);
+
+    template <>
+    constexpr float reflectivity_epsilon<float> = static_cast<float>(RAYTRACER_FLOAT_REFLECTIVITY_EPSILON);
+}
+
+}
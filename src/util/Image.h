@@ -0,0 +1,504 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Vec.h"
+
+#ifndef RAYTRACER_PNG_ROWS_PER_BLOCK
+// Rows of the image compressed independently (and in parallel) into one part of the deflate stream
+#    define RAYTRACER_PNG_ROWS_PER_BLOCK 32
+#endif
+
+namespace Raytracer {
+
+namespace Image {
+    /**
+     * Image writers for the framebuffer returned by Camera::render()
+     *
+     * Pixels are stored row by row, top row first. Every writer assembles the whole file in memory and
+     * hands it to the OS in a single write; they return false if the file could not be written.
+     */
+
+    bool inline write_file(std::string const& path, std::span<uint8_t const> header, std::span<uint8_t const> data)
+    {
+        auto* file = std::fopen(path.c_str(), "wb");
+
+        if (!file)
+            return false;
+
+        auto ok = std::fwrite(header.data(), 1, header.size(), file) == header.size()
+                  && std::fwrite(data.data(), 1, data.size(), file) == data.size();
+
+        return std::fclose(file) == 0 && ok;
+    }
+
+    std::span<uint8_t const> inline as_bytes(std::string const& string)
+    {
+        return { reinterpret_cast<uint8_t const*>(string.data()), string.size() };
+    }
+
+    // Binary NetPBM (P6); the pixels are already packed RGB bytes so they are written as they are
+    bool inline write_ppm(std::string const& path, std::span<Vec3<uint8_t> const> pixels, std::size_t width, std::size_t height)
+    {
+        static_assert(sizeof(Vec3<uint8_t>) == 3);
+
+        auto const header = "P6\n" + std::to_string(width) + ' ' + std::to_string(height) + "\n255\n";
+
+        return write_file(path, as_bytes(header), { reinterpret_cast<uint8_t const*>(pixels.data()), 3 * width * height });
+    }
+
+    // Portable float map (PF), little endian; rows are stored bottom row first as the format requires
+    template <typename T>
+    bool write_pfm(std::string const& path, std::span<Vec3<T> const> pixels, std::size_t width, std::size_t height)
+    {
+        auto const header = "PF\n" + std::to_string(width) + ' ' + std::to_string(height) + "\n-1.0\n";
+        auto data = std::vector<float>(3 * width * height);
+
+        for (auto row = 0uz; row < height; row++) {
+            auto const* source = pixels.data() + (height - row - 1) * width;
+            auto* destination = data.data() + 3 * row * width;
+
+            for (auto i = 0uz; i < width; i++)
+                source[i].for_each_const([&](auto const& a, auto idx) {
+                    if constexpr (std::is_integral_v<T>)
+                        destination[3 * i + idx] = static_cast<float>(a) / std::numeric_limits<T>::max();
+                    else
+                        destination[3 * i + idx] = static_cast<float>(a);
+                });
+        }
+
+        return write_file(path, as_bytes(header), { reinterpret_cast<uint8_t const*>(data.data()), data.size() * sizeof(float) });
+    }
+
+    namespace Detail {
+        class BitWriter {
+        private:
+            std::vector<uint8_t>& m_output;
+            uint64_t m_buffer;
+            uint32_t m_count;
+
+        public:
+            BitWriter(std::vector<uint8_t>& output)
+                : m_output(output)
+                , m_buffer(0)
+                , m_count(0) {};
+
+            // Deflate packs bits starting from the least significant bit of every byte; count is at most 32
+            void write(uint32_t bits, uint32_t count)
+            {
+                m_buffer |= static_cast<uint64_t>(bits) << m_count;
+                m_count += count;
+
+                if (m_count >= 32) {
+                    uint8_t const bytes[4] = {
+                        static_cast<uint8_t>(m_buffer),
+                        static_cast<uint8_t>(m_buffer >> 8),
+                        static_cast<uint8_t>(m_buffer >> 16),
+                        static_cast<uint8_t>(m_buffer >> 24),
+                    };
+
+                    m_output.insert(m_output.end(), bytes, bytes + 4);
+                    m_buffer >>= 32;
+                    m_count -= 32;
+                }
+            }
+
+            // Pads to a byte boundary and flushes the buffer
+            void align()
+            {
+                for (m_count = (m_count + 7) & ~7u; m_count; m_count -= 8) {
+                    m_output.push_back(static_cast<uint8_t>(m_buffer));
+                    m_buffer >>= 8;
+                }
+            }
+        };
+
+        struct Code {
+            uint16_t m_bits; // Bit reversed, so that it can be written least significant bit first
+            uint8_t m_length;
+        };
+
+        struct Symbol {
+            uint16_t m_code;
+            uint8_t m_extra_length;
+            uint16_t m_extra;
+        };
+
+        constexpr uint16_t reverse(uint16_t bits, uint8_t length)
+        {
+            auto result = uint16_t {};
+
+            for (auto i = 0; i < length; i++)
+                result |= ((bits >> i) & 1) << (length - i - 1);
+
+            return result;
+        }
+
+        struct Tables {
+            std::array<Code, 288> m_literals;
+            std::array<Code, 30> m_distances;
+            std::array<Symbol, 259> m_lengths;
+
+            std::array<uint16_t, 30> m_distance_base;
+            std::array<uint8_t, 30> m_distance_extra;
+
+            // Distance code of distance d, at d - 1 for distances up to 256 and at 256 + ((d - 1) >> 7) above
+            std::array<uint8_t, 512> m_distance_codes;
+
+            constexpr Tables()
+                : m_literals {}
+                , m_distances {}
+                , m_lengths {}
+                , m_distance_base {}
+                , m_distance_extra {}
+                , m_distance_codes {}
+            {
+                // Fixed Huffman codes, RFC 1951 section 3.2.6
+                for (auto i = 0; i < 288; i++) {
+                    if (i < 144)
+                        m_literals[i] = { reverse(0x30 + i, 8), 8 };
+                    else if (i < 256)
+                        m_literals[i] = { reverse(0x190 + i - 144, 9), 9 };
+                    else if (i < 280)
+                        m_literals[i] = { reverse(i - 256, 7), 7 };
+                    else
+                        m_literals[i] = { reverse(0xc0 + i - 280, 8), 8 };
+                }
+
+                for (auto i = 0; i < 30; i++)
+                    m_distances[i] = { reverse(i, 5), 5 };
+
+                // Length codes 257..285 for match lengths 3..258
+                auto length = 3;
+
+                for (auto code = 257; code < 285; code++) {
+                    auto const extra = code < 265 ? 0 : (code - 261) / 4;
+
+                    for (auto i = 0; i < (1 << extra); i++, length++)
+                        m_lengths[length] = { static_cast<uint16_t>(code), static_cast<uint8_t>(extra), static_cast<uint16_t>(i) };
+                }
+
+                m_lengths[258] = { 285, 0, 0 };
+
+                // Distance codes 0..29 for distances 1..32768
+                auto distance = 1;
+
+                for (auto code = 0; code < 30; code++) {
+                    auto const extra = code < 4 ? 0 : code / 2 - 1;
+
+                    m_distance_base[code] = static_cast<uint16_t>(distance);
+                    m_distance_extra[code] = static_cast<uint8_t>(extra);
+                    distance += 1 << extra;
+                }
+
+                for (auto code = 0; code < 30; code++)
+                    for (auto d = m_distance_base[code] - 1; d < m_distance_base[code] - 1 + (1 << m_distance_extra[code]); d++)
+                        m_distance_codes[d < 256 ? d : 256 + (d >> 7)] = static_cast<uint8_t>(code);
+            }
+        };
+
+        constexpr auto tables = Tables {};
+
+        auto inline distance_code(uint32_t distance)
+        {
+            auto const d = distance - 1;
+
+            return tables.m_distance_codes[d < 256 ? d : 256 + (d >> 7)];
+        }
+
+        /**
+         * Compresses data into a sequence of fixed Huffman deflate blocks with greedy LZ77 matching and ends it
+         * with an empty stored block so that it stops on a byte boundary. Such pieces, compressed independently,
+         * can be concatenated into one stream; the matches never reach into a previous piece.
+         */
+        void inline deflate(std::span<uint8_t const> data, std::vector<uint8_t>& output)
+        {
+            constexpr auto hash_bits = 15;
+            constexpr auto window = 32768uz;
+            constexpr auto max_match = 258uz;
+
+            auto head = std::vector<int32_t>(1 << hash_bits, -1);
+
+            // Fixed codes are at most 9 bits per literal
+            output.reserve(output.size() + data.size() + data.size() / 8 + 16);
+
+            auto writer = BitWriter(output);
+
+            auto hash = [&](std::size_t i) {
+                auto const value = data[i] | data[i + 1] << 8 | data[i + 2] << 16;
+                return (value * 2654435761u) >> (32 - hash_bits);
+            };
+
+            // BFINAL = 0, BTYPE = 01 (fixed Huffman codes)
+            writer.write(0b010, 3);
+
+            auto i = 0uz;
+
+            while (i < data.size()) {
+                auto match_length = 0uz;
+                auto match_distance = 0uz;
+
+                if (i + 3 <= data.size()) {
+                    auto const h = hash(i);
+                    auto const candidate = head[h];
+
+                    head[h] = static_cast<int32_t>(i);
+
+                    if (candidate >= 0 && i - candidate <= window) {
+                        auto const limit = std::min(max_match, data.size() - i);
+
+                        while (match_length < limit && data[candidate + match_length] == data[i + match_length])
+                            match_length++;
+
+                        match_distance = i - candidate;
+                    }
+                }
+
+                if (match_length < 3) {
+                    auto const& code = tables.m_literals[data[i]];
+
+                    writer.write(code.m_bits, code.m_length);
+                    i++;
+                    continue;
+                }
+
+                auto const& length = tables.m_lengths[match_length];
+                auto const& length_code = tables.m_literals[length.m_code];
+
+                writer.write(length_code.m_bits, length_code.m_length);
+                writer.write(length.m_extra, length.m_extra_length);
+
+                auto const distance = distance_code(match_distance);
+
+                writer.write(tables.m_distances[distance].m_bits, tables.m_distances[distance].m_length);
+                writer.write(match_distance - tables.m_distance_base[distance], tables.m_distance_extra[distance]);
+
+                // Index the positions covered by the match so later data can refer to them
+                for (auto j = i + 1; j < i + match_length && j + 3 <= data.size(); j++)
+                    head[hash(j)] = static_cast<int32_t>(j);
+
+                i += match_length;
+            }
+
+            // End of block, then an empty stored block (BFINAL = 0, BTYPE = 00, LEN = 0, NLEN = 0xffff)
+            writer.write(tables.m_literals[256].m_bits, tables.m_literals[256].m_length);
+            writer.write(0, 3);
+            writer.align();
+            output.insert(output.end(), { 0x00, 0x00, 0xff, 0xff });
+        }
+
+        auto inline crc32(uint32_t crc, std::span<uint8_t const> data)
+        {
+            static auto const table = []() {
+                auto table = std::array<uint32_t, 256> {};
+
+                for (auto i = 0u; i < 256; i++) {
+                    auto c = i;
+
+                    for (auto k = 0; k < 8; k++)
+                        c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+
+                    table[i] = c;
+                }
+
+                return table;
+            }();
+
+            crc = ~crc;
+
+            for (auto byte : data)
+                crc = table[(crc ^ byte) & 0xff] ^ (crc >> 8);
+
+            return ~crc;
+        }
+
+        auto inline adler32(uint32_t adler, std::span<uint8_t const> data)
+        {
+            auto a = adler & 0xffff;
+            auto b = adler >> 16;
+
+            // 5552 is the largest block for which b cannot overflow 32 bits before the modulo
+            for (auto offset = 0uz; offset < data.size(); offset += 5552) {
+                auto const end = std::min(data.size(), offset + 5552);
+
+                for (auto i = offset; i < end; i++) {
+                    a += data[i];
+                    b += a;
+                }
+
+                a %= 65521;
+                b %= 65521;
+            }
+
+            return b << 16 | a;
+        }
+
+        void inline append_u32(std::vector<uint8_t>& output, uint32_t value)
+        {
+            for (auto shift = 24; shift >= 0; shift -= 8)
+                output.push_back(static_cast<uint8_t>(value >> shift));
+        }
+
+        void inline append_chunk(std::vector<uint8_t>& output, char const* type, std::span<uint8_t const> data)
+        {
+            append_u32(output, static_cast<uint32_t>(data.size()));
+
+            auto const start = output.size();
+            output.insert(output.end(), type, type + 4);
+            output.insert(output.end(), data.begin(), data.end());
+
+            append_u32(output, crc32(0, { output.data() + start, output.size() - start }));
+        }
+
+        // Filters one row of RGB bytes with every filter type and keeps the one with the smallest sum of
+        // absolute values; scratch holds 5 rows of length + 1 bytes. The first row has no previous row.
+        void inline filter_row(uint8_t const* row, uint8_t const* previous, std::size_t length, uint8_t* scratch, uint8_t* output)
+        {
+            constexpr auto bpp = 3uz;
+
+            auto paeth = [](int a, int b, int c) {
+                auto const p = a + b - c;
+                auto const pa = std::abs(p - a);
+                auto const pb = std::abs(p - b);
+                auto const pc = std::abs(p - c);
+
+                return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+            };
+
+            uint8_t* filtered[5];
+            std::size_t costs[5] = {};
+
+            for (auto type = 0uz; type < 5; type++) {
+                filtered[type] = scratch + type * (length + 1) + 1;
+                filtered[type][-1] = static_cast<uint8_t>(type);
+            }
+
+            thread_local auto zeros = std::vector<uint8_t> {};
+
+            if (!previous) {
+                zeros.assign(length, 0);
+                previous = zeros.data();
+            }
+
+            auto filter = [&](std::size_t i, int left, int up, int up_left) {
+                uint8_t const residuals[5] = {
+                    row[i],
+                    static_cast<uint8_t>(row[i] - left),
+                    static_cast<uint8_t>(row[i] - up),
+                    static_cast<uint8_t>(row[i] - (left + up) / 2),
+                    static_cast<uint8_t>(row[i] - paeth(left, up, up_left)),
+                };
+
+                for (auto type = 0uz; type < 5; type++) {
+                    filtered[type][i] = residuals[type];
+                    costs[type] += std::abs(static_cast<int8_t>(residuals[type]));
+                }
+            };
+
+            // The first pixel has no left neighbour, the loop over the rest has no branches
+            for (auto i = 0uz; i < std::min(bpp, length); i++)
+                filter(i, 0, previous[i], 0);
+
+            for (auto i = bpp; i < length; i++)
+                filter(i, row[i - bpp], previous[i], previous[i - bpp]);
+
+            auto const best_type = std::min_element(costs, costs + 5) - costs;
+
+            std::memcpy(output, filtered[best_type] - 1, length + 1);
+        }
+    }
+
+    /**
+     * 8-bit RGB PNG
+     *
+     * Rows are filtered and deflated in blocks of RAYTRACER_PNG_ROWS_PER_BLOCK rows spread over the given
+     * number of threads (0 uses one per hardware thread); the compressed blocks are concatenated into a single
+     * zlib stream.
+     */
+    bool inline write_png(std::string const& path, std::span<Vec3<uint8_t> const> pixels, std::size_t width, std::size_t height, std::size_t threads = 0)
+    {
+        using namespace Detail;
+
+        auto const row_length = 3 * width;
+        auto const* bytes = reinterpret_cast<uint8_t const*>(pixels.data());
+
+        auto const blocks = (height + RAYTRACER_PNG_ROWS_PER_BLOCK - 1) / RAYTRACER_PNG_ROWS_PER_BLOCK;
+        auto filtered = std::vector<uint8_t>((row_length + 1) * height);
+        auto compressed = std::vector<std::vector<uint8_t>>(blocks);
+
+        if (!threads)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+
+        {
+            auto next_block = std::atomic_size_t {};
+            auto workers = std::vector<std::jthread> {};
+
+            for (auto t = 0uz; t < std::min(threads, blocks); t++)
+                workers.emplace_back([&]() {
+                    auto scratch = std::vector<uint8_t> {};
+
+                    while (true) {
+                        auto const block = next_block.fetch_add(1, std::memory_order_relaxed);
+
+                        if (block >= blocks)
+                            break;
+
+                        auto const first = block * RAYTRACER_PNG_ROWS_PER_BLOCK;
+                        auto const last = std::min(height, first + RAYTRACER_PNG_ROWS_PER_BLOCK);
+
+                        scratch.resize(5 * (row_length + 1));
+
+                        for (auto row = first; row < last; row++)
+                            filter_row(
+                                bytes + row * row_length,
+                                row ? bytes + (row - 1) * row_length : nullptr,
+                                row_length,
+                                scratch.data(),
+                                filtered.data() + row * (row_length + 1));
+
+                        auto const begin = filtered.data() + first * (row_length + 1);
+                        auto const end = filtered.data() + last * (row_length + 1);
+
+                        deflate({ begin, end }, compressed[block]);
+                    }
+                });
+        }
+
+        // zlib header (deflate, 32K window, no dictionary), the blocks, a final empty fixed Huffman block
+        // and the Adler-32 checksum of the uncompressed data
+        auto zlib = std::vector<uint8_t> { 0x78, 0x01 };
+
+        for (auto&& block : compressed)
+            zlib.insert(zlib.end(), block.begin(), block.end());
+
+        zlib.push_back(0x03);
+        zlib.push_back(0x00);
+        append_u32(zlib, adler32(1, filtered));
+
+        auto header = std::vector<uint8_t> { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+        auto ihdr = std::vector<uint8_t> {};
+
+        append_u32(ihdr, static_cast<uint32_t>(width));
+        append_u32(ihdr, static_cast<uint32_t>(height));
+        ihdr.insert(ihdr.end(), { 8, 2, 0, 0, 0 }); // 8 bits per channel, RGB, deflate, adaptive filtering, no interlace
+
+        append_chunk(header, "IHDR", ihdr);
+        append_chunk(header, "IDAT", zlib);
+        append_chunk(header, "IEND", {});
+
+        return write_file(path, header, {});
+    }
+}
+
+}
@@ -1,8 +1,47 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <limits>
+
 #include "Vec.h"
 
-struct Light {
-    Vec3<double> m_position;
-    Vec3<double> m_color;
+template <std::floating_point T>
+struct BasicLight {
+    Vec3<T> m_position;
+    Vec3<T> m_color;
+
+    // Distance from which the light no longer reaches; lights without a range light everything undimmed
+    T m_range = std::numeric_limits<T>::infinity();
+
+    bool is_bounded() const { return std::isfinite(m_range); }
+
+    // Fraction of the light reaching a point at the given squared distance, going smoothly from 1 at the
+    // light to 0 at m_range
+    T falloff(T distance_squared) const
+    {
+        if (!is_bounded())
+            return 1;
+
+        auto const x = distance_squared / (m_range * m_range);
+        auto const window = std::max(T { 0 }, 1 - x * x);
+
+        return window * window;
+    }
+};
+
+using Light = BasicLight<double>;
+
+enum class LightMode {
+    Exact,   // Every light in range of a point
+    Sampled, // A fixed number of the lights in range, picked by how much light they are likely to bring
+};
+
+struct LightSampling {
+    LightMode m_mode = LightMode::Exact;
+
+    // Sampled: shadow rays per hit; points with at most as many lights in range are shaded exactly
+    std::size_t m_samples = 8;
 };
@@ -24,7 +24,9 @@ namespace Lighting {
          *      V - viewing direction or light direction
          */
 
-        return r0 + (1. - r0) * pow(1. - cos, 5.);
+        using T = decltype(cos);
+
+        return r0 + (1 - r0) * std::pow(1 - cos, T { 5 });
     }
 
     auto inline beckmann_distribution(auto HN, auto m)
@@ -38,18 +40,18 @@ namespace Lighting {
          */
 
         auto cos2 = HN * HN;
-        auto tan2 = (cos2 - 1.) / cos2;
+        auto tan2 = (cos2 - 1) / cos2;
         auto m2 = m * m;
 
-        return std::exp(tan2 / m2) / (M_PI * m2 * cos2 * cos2);
+        return std::exp(tan2 / m2) / (static_cast<decltype(HN)>(M_PI) * m2 * cos2 * cos2);
     }
 
     auto inline geometric_attenuation(auto HN, auto LN, auto EN, auto EH)
     {
         // Geometric attenuation describes selfshadowing from microfacets
 
-        auto common = 2. * HN / EH;
-        return std::min(1., std::min(common * EN, common * LN));
+        auto common = 2 * HN / EH;
+        return std::min(decltype(HN) { 1 }, std::min(common * EN, common * LN));
     }
 }
 
@@ -66,18 +68,19 @@ __attribute__((flatten)) auto specular(auto const& L, auto const& N, auto const&
      */
 
     auto H = normalize(L + E); // Halfway vector
+    using T = decltype(dot(H, N));
 
     auto EN = dot(E, N);
     auto LN = dot(L, N);
-    auto HN = std::max(RAYTRACER_EPSILON, dot(H, N));
+    auto HN = std::max(Config::epsilon<T>, dot(H, N));
 
     auto G = Lighting::geometric_attenuation(HN, LN, EN, dot(E, H));
     auto D = Lighting::beckmann_distribution(HN, m);
 
-    auto r0 = std::pow((ior1 - ior2) / (ior1 + ior2), 2.);
+    auto r0 = std::pow((ior1 - ior2) / (ior1 + ior2), T { 2 });
     auto F = Lighting::schlick_approximation(r0, EN);
 
-    return (D * F * G) / (4. * EN * LN);
+    return (D * F * G) / (4 * EN * LN);
 }
 
 }
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+private:
+    int m_descriptor;
+    char const* m_data;
+    std::size_t m_size;
+
+public:
+    MappedFile(std::string const& path)
+        : m_descriptor(::open(path.c_str(), O_RDONLY))
+        , m_data(nullptr)
+        , m_size(0)
+    {
+        struct stat status;
+
+        if (m_descriptor < 0 || ::fstat(m_descriptor, &status) != 0 || status.st_size == 0)
+            return;
+
+        auto* data = ::mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, m_descriptor, 0);
+
+        if (data == MAP_FAILED)
+            return;
+
+        ::madvise(data, status.st_size, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+        m_data = static_cast<char const*>(data);
+        m_size = status.st_size;
+    }
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    ~MappedFile()
+    {
+        if (m_data)
+            ::munmap(const_cast<char*>(m_data), m_size);
+
+        if (m_descriptor >= 0)
+            ::close(m_descriptor);
+    }
+
+    bool is_open() const { return m_data != nullptr; }
+    auto get_contents() const { return std::string_view(m_data, m_size); }
+};
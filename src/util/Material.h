@@ -1,13 +1,22 @@
 #pragma once
 
+#include <concepts>
+#include <cstdint>
+
 #include "Vec.h"
 
-struct Material {
-    Vec3<double> ka; // Ambient
-    Vec3<double> kd; // Diffuse
-    Vec3<double> ks; // Specular
-    Vec3<double> km; // Reflectivity
+// Index into the scene's material table, see BasicScene::add_material()
+using MaterialId = uint32_t;
+
+template <std::floating_point T>
+struct BasicMaterial {
+    Vec3<T> ka; // Ambient
+    Vec3<T> kd; // Diffuse
+    Vec3<T> ks; // Specular
+    Vec3<T> km; // Reflectivity
 
-    double m; // Roughness (rms slope of microfacets)
-    double ior;
+    T m; // Roughness (rms slope of microfacets)
+    T ior;
 };
+
+using Material = BasicMaterial<double>;
@@ -0,0 +1,566 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "MappedFile.h"
+#include "Vec.h"
+
+// Vertex and index buffers of a triangle mesh, stored as structure of arrays.
+struct MeshData {
+    std::vector<double> m_x;
+    std::vector<double> m_y;
+    std::vector<double> m_z;
+
+    // Per-vertex normals for smooth shading; empty for flat shading
+    std::vector<double> m_nx;
+    std::vector<double> m_ny;
+    std::vector<double> m_nz;
+
+    // Three vertex indices per triangle
+    std::vector<uint32_t> m_indices;
+
+    auto get_vertex_count() const { return m_x.size(); }
+    auto get_triangle_count() const { return m_indices.size() / 3; }
+    bool has_normals() const { return !m_nx.empty(); }
+
+    auto get_vertex(std::size_t i) const { return Vec3<double> { m_x[i], m_y[i], m_z[i] }; }
+    auto get_normal(std::size_t i) const { return Vec3<double> { m_nx[i], m_ny[i], m_nz[i] }; }
+
+    void add_vertex(Vec3<double> const& vertex)
+    {
+        m_x.push_back(vertex.x);
+        m_y.push_back(vertex.y);
+        m_z.push_back(vertex.z);
+    }
+
+    void add_normal(Vec3<double> const& normal)
+    {
+        m_nx.push_back(normal.x);
+        m_ny.push_back(normal.y);
+        m_nz.push_back(normal.z);
+    }
+};
+
+namespace Raytracer {
+
+namespace Mesh {
+    namespace Detail {
+        bool inline is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+        inline char const* skip_spaces(char const* first, char const* last)
+        {
+            while (first < last && is_space(*first))
+                first++;
+
+            return first;
+        }
+
+        // Index of a face corner as written in an OBJ file; relative (negative) indices count back from the
+        // last vertex defined in the same chunk and are made absolute once the chunks are joined.
+        struct Corner {
+            int64_t m_index;
+            bool m_relative;
+        };
+
+        struct ObjChunk {
+            MeshData m_mesh;
+            std::vector<Corner> m_corners; // Three per triangle
+
+            bool m_normals_match = true; // Every corner used the same index for its position and normal
+            bool m_valid = true;
+        };
+
+        void inline parse_obj(std::string_view text, ObjChunk& chunk)
+        {
+            auto const* position = text.data();
+            auto const* const end = text.data() + text.size();
+
+            auto parse_vector = [&](char const*& first, char const* last, Vec3<double>& vector) {
+                for (auto axis = 0uz; axis < 3; axis++) {
+                    first = skip_spaces(first, last);
+
+                    auto const [next, error] = std::from_chars(first, last, vector[axis]);
+
+                    if (error != std::errc {})
+                        return false;
+
+                    first = next;
+                }
+
+                return true;
+            };
+
+            auto polygon = std::vector<Corner> {};
+
+            while (position < end && chunk.m_valid) {
+                auto const* line_end = static_cast<char const*>(std::memchr(position, '\n', end - position));
+
+                if (!line_end)
+                    line_end = end;
+
+                auto const* first = skip_spaces(position, line_end);
+                position = line_end + 1;
+
+                auto const* keyword_end = first;
+
+                while (keyword_end < line_end && !is_space(*keyword_end))
+                    keyword_end++;
+
+                auto const keyword = std::string_view(first, keyword_end - first);
+                auto vector = Vec3<double> {};
+
+                first = keyword_end;
+
+                if (keyword == "v") {
+                    chunk.m_valid = parse_vector(first, line_end, vector);
+                    chunk.m_mesh.add_vertex(vector);
+                } else if (keyword == "vn") {
+                    chunk.m_valid = parse_vector(first, line_end, vector);
+                    chunk.m_mesh.add_normal(vector);
+                } else if (keyword == "f") {
+                    polygon.clear();
+
+                    // Corners are v, v/vt, v//vn or v/vt/vn
+                    while ((first = skip_spaces(first, line_end)) < line_end) {
+                        auto index = int64_t {};
+                        auto [next, error] = std::from_chars(first, line_end, index);
+
+                        if (error != std::errc {} || index == 0) {
+                            chunk.m_valid = false;
+                            break;
+                        }
+
+                        auto normal = index;
+
+                        for (auto slash = 0; next < line_end && *next == '/'; slash++) {
+                            auto value = int64_t {};
+                            auto const result = std::from_chars(++next, line_end, value);
+
+                            if (result.ec == std::errc {}) {
+                                if (slash == 1)
+                                    normal = value;
+
+                                next = result.ptr;
+                            }
+                        }
+
+                        chunk.m_normals_match &= normal == index;
+
+                        if (index > 0)
+                            polygon.push_back({ index - 1, false });
+                        else
+                            polygon.push_back({ static_cast<int64_t>(chunk.m_mesh.get_vertex_count()) + index, true });
+
+                        first = next;
+                    }
+
+                    // Polygons are triangulated as a fan around their first corner
+                    for (auto i = 2uz; i < polygon.size(); i++)
+                        chunk.m_corners.insert(chunk.m_corners.end(), { polygon[0], polygon[i - 1], polygon[i] });
+                }
+            }
+        }
+
+        enum class PlyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Invalid };
+
+        struct PlyProperty {
+            std::string m_name;
+            PlyType m_type;
+            PlyType m_count_type = PlyType::Invalid; // Set for list properties
+        };
+
+        struct PlyElement {
+            std::string m_name;
+            std::size_t m_count;
+            std::vector<PlyProperty> m_properties;
+        };
+
+        PlyType inline parse_ply_type(std::string_view name)
+        {
+            if (name == "char" || name == "int8")
+                return PlyType::Int8;
+            if (name == "uchar" || name == "uint8")
+                return PlyType::UInt8;
+            if (name == "short" || name == "int16")
+                return PlyType::Int16;
+            if (name == "ushort" || name == "uint16")
+                return PlyType::UInt16;
+            if (name == "int" || name == "int32")
+                return PlyType::Int32;
+            if (name == "uint" || name == "uint32")
+                return PlyType::UInt32;
+            if (name == "float" || name == "float32")
+                return PlyType::Float32;
+            if (name == "double" || name == "float64")
+                return PlyType::Float64;
+
+            return PlyType::Invalid;
+        }
+
+        std::size_t inline get_size(PlyType type)
+        {
+            constexpr std::size_t sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8, 0 };
+
+            return sizes[static_cast<std::size_t>(type)];
+        }
+
+        // Reads a little endian value of the given type
+        double inline read(char const* data, PlyType type)
+        {
+            auto load = [data]<typename T>(T) {
+                auto value = T {};
+                std::memcpy(&value, data, sizeof(T));
+                return static_cast<double>(value);
+            };
+
+            switch (type) {
+            case PlyType::Int8:
+                return load(int8_t {});
+            case PlyType::UInt8:
+                return load(uint8_t {});
+            case PlyType::Int16:
+                return load(int16_t {});
+            case PlyType::UInt16:
+                return load(uint16_t {});
+            case PlyType::Int32:
+                return load(int32_t {});
+            case PlyType::UInt32:
+                return load(uint32_t {});
+            case PlyType::Float32:
+                return load(float {});
+            case PlyType::Float64:
+                return load(double {});
+            default:
+                return 0.;
+            }
+        }
+
+        std::size_t inline get_thread_count(std::size_t threads)
+        {
+            return threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+        }
+    }
+
+    /**
+     * Wavefront OBJ
+     *
+     * Reads vertices, faces (triangulated as fans) and normals; texture coordinates and everything else are
+     * ignored. The file is memory mapped and split into one chunk of whole lines per thread (0 uses one per
+     * hardware thread), which are parsed in parallel and joined. Normals are kept only if the file has one
+     * per vertex and every face corner uses the same index for both, otherwise the mesh is flat shaded.
+     *
+     * Returns false if the file could not be read or is malformed.
+     */
+    bool inline load_obj(std::string const& path, MeshData& mesh, std::size_t threads = 0)
+    {
+        using namespace Detail;
+
+        auto const file = MappedFile(path);
+
+        if (!file.is_open())
+            return false;
+
+        auto const text = file.get_contents();
+        auto const chunk_count = std::min(get_thread_count(threads), std::max(1uz, text.size() >> 16));
+        auto chunks = std::vector<ObjChunk>(chunk_count);
+
+        {
+            auto workers = std::vector<std::jthread> {};
+            auto begin = 0uz;
+
+            for (auto i = 0uz; i < chunk_count; i++) {
+                auto end = i + 1 == chunk_count ? text.size() : std::max(begin, (i + 1) * text.size() / chunk_count);
+
+                // Chunks end after a newline so that no line is split between two of them
+                end = std::min(text.size(), text.find('\n', end) + 1);
+
+                if (!end)
+                    end = text.size();
+
+                workers.emplace_back(parse_obj, text.substr(begin, end - begin), std::ref(chunks[i]));
+                begin = end;
+            }
+        }
+
+        mesh = {};
+
+        auto vertex_count = 0uz;
+        auto normal_count = 0uz;
+        auto normals_match = true;
+
+        for (auto&& chunk : chunks) {
+            if (!chunk.m_valid)
+                return false;
+
+            vertex_count += chunk.m_mesh.get_vertex_count();
+            normal_count += chunk.m_mesh.m_nx.size();
+            normals_match &= chunk.m_normals_match;
+        }
+
+        auto const keep_normals = normal_count && normal_count == vertex_count && normals_match;
+        auto corner_count = 0uz;
+
+        for (auto&& chunk : chunks)
+            corner_count += chunk.m_corners.size();
+
+        for (auto* buffer : { &mesh.m_x, &mesh.m_y, &mesh.m_z })
+            buffer->reserve(vertex_count);
+
+        mesh.m_indices.reserve(corner_count);
+
+        auto first_vertex = 0uz;
+
+        for (auto&& chunk : chunks) {
+            mesh.m_x.insert(mesh.m_x.end(), chunk.m_mesh.m_x.begin(), chunk.m_mesh.m_x.end());
+            mesh.m_y.insert(mesh.m_y.end(), chunk.m_mesh.m_y.begin(), chunk.m_mesh.m_y.end());
+            mesh.m_z.insert(mesh.m_z.end(), chunk.m_mesh.m_z.begin(), chunk.m_mesh.m_z.end());
+
+            if (keep_normals) {
+                mesh.m_nx.insert(mesh.m_nx.end(), chunk.m_mesh.m_nx.begin(), chunk.m_mesh.m_nx.end());
+                mesh.m_ny.insert(mesh.m_ny.end(), chunk.m_mesh.m_ny.begin(), chunk.m_mesh.m_ny.end());
+                mesh.m_nz.insert(mesh.m_nz.end(), chunk.m_mesh.m_nz.begin(), chunk.m_mesh.m_nz.end());
+            }
+
+            for (auto&& corner : chunk.m_corners) {
+                auto const index = corner.m_index + (corner.m_relative ? static_cast<int64_t>(first_vertex) : 0);
+
+                if (index < 0 || static_cast<std::size_t>(index) >= vertex_count)
+                    return false;
+
+                mesh.m_indices.push_back(static_cast<uint32_t>(index));
+            }
+
+            first_vertex += chunk.m_mesh.get_vertex_count();
+        }
+
+        return true;
+    }
+
+    /**
+     * Binary little endian PLY
+     *
+     * Reads the x, y, z (and nx, ny, nz if present) properties of the vertex element and the vertex_indices
+     * list of the face element, triangulating polygons as fans; other elements and properties are skipped.
+     * The file is memory mapped and the fixed size vertex records are converted in parallel.
+     *
+     * Returns false if the file could not be read, is not binary little endian, or is malformed.
+     */
+    bool inline load_ply(std::string const& path, MeshData& mesh, std::size_t threads = 0)
+    {
+        using namespace Detail;
+
+        auto const file = MappedFile(path);
+
+        if (!file.is_open())
+            return false;
+
+        auto const contents = file.get_contents();
+        auto const header_end = contents.find("end_header\n");
+
+        if (!contents.starts_with("ply\n") || header_end == std::string_view::npos)
+            return false;
+
+        auto elements = std::vector<PlyElement> {};
+        auto binary_little_endian = false;
+
+        // Header, one keyword per line
+        for (auto position = contents.find('\n') + 1; position < header_end;) {
+            auto const line_end = contents.find('\n', position);
+            auto line = contents.substr(position, line_end - position);
+            position = line_end + 1;
+
+            auto words = std::vector<std::string_view> {};
+
+            while (!line.empty()) {
+                auto const word_begin = line.find_first_not_of(" \t\r");
+
+                if (word_begin == std::string_view::npos)
+                    break;
+
+                auto const word_end = std::min(line.size(), line.find_first_of(" \t\r", word_begin));
+                words.push_back(line.substr(word_begin, word_end - word_begin));
+                line.remove_prefix(word_end);
+            }
+
+            if (words.empty())
+                continue;
+
+            if (words[0] == "format") {
+                binary_little_endian = words.size() > 1 && words[1] == "binary_little_endian";
+            } else if (words[0] == "element" && words.size() == 3) {
+                auto count = 0uz;
+                std::from_chars(words[2].data(), words[2].data() + words[2].size(), count);
+                elements.push_back({ std::string(words[1]), count, {} });
+            } else if (words[0] == "property" && !elements.empty()) {
+                if (words.size() == 5 && words[1] == "list")
+                    elements.back().m_properties.push_back({ std::string(words[4]), parse_ply_type(words[3]), parse_ply_type(words[2]) });
+                else if (words.size() == 3)
+                    elements.back().m_properties.push_back({ std::string(words[2]), parse_ply_type(words[1]) });
+                else
+                    return false;
+
+                if (elements.back().m_properties.back().m_type == PlyType::Invalid)
+                    return false;
+            }
+        }
+
+        if (!binary_little_endian)
+            return false;
+
+        mesh = {};
+
+        auto const* data = contents.data() + header_end + std::strlen("end_header\n");
+        auto const* const end = contents.data() + contents.size();
+
+        for (auto&& element : elements) {
+            auto const is_list = [](auto const& property) { return property.m_count_type != PlyType::Invalid; };
+
+            if (element.m_name == "vertex") {
+                // Vertex records have a fixed size; find the offsets of the properties we read
+                auto stride = 0uz;
+                std::size_t offsets[6];
+                PlyType types[6];
+                auto found = 0u;
+
+                constexpr std::string_view names[6] = { "x", "y", "z", "nx", "ny", "nz" };
+
+                for (auto&& property : element.m_properties) {
+                    if (is_list(property))
+                        return false;
+
+                    for (auto i = 0uz; i < 6; i++)
+                        if (property.m_name == names[i]) {
+                            offsets[i] = stride;
+                            types[i] = property.m_type;
+                            found |= 1u << i;
+                        }
+
+                    stride += get_size(property.m_type);
+                }
+
+                auto const normals = (found & 0b111000) == 0b111000;
+
+                if ((found & 0b111) != 0b111 || static_cast<std::size_t>(end - data) < stride * element.m_count)
+                    return false;
+
+                std::vector<double>* buffers[6] = { &mesh.m_x, &mesh.m_y, &mesh.m_z, &mesh.m_nx, &mesh.m_ny, &mesh.m_nz };
+
+                for (auto i = 0uz; i < (normals ? 6uz : 3uz); i++)
+                    buffers[i]->resize(element.m_count);
+
+                {
+                    auto const thread_count = std::min(get_thread_count(threads), std::max(1uz, element.m_count >> 14));
+                    auto workers = std::vector<std::jthread> {};
+
+                    for (auto t = 0uz; t < thread_count; t++)
+                        workers.emplace_back([&, t]() {
+                            auto const first = t * element.m_count / thread_count;
+                            auto const last = (t + 1) * element.m_count / thread_count;
+
+                            for (auto v = first; v < last; v++)
+                                for (auto i = 0uz; i < (normals ? 6uz : 3uz); i++)
+                                    (*buffers[i])[v] = read(data + v * stride + offsets[i], types[i]);
+                        });
+                }
+
+                data += stride * element.m_count;
+            } else if (element.m_name == "face") {
+                // Face records are variable length, so they are read in order
+                mesh.m_indices.reserve(3 * element.m_count);
+
+                auto polygon = std::vector<uint32_t> {};
+
+                for (auto f = 0uz; f < element.m_count; f++)
+                    for (auto&& property : element.m_properties) {
+                        auto const count_size = is_list(property) ? get_size(property.m_count_type) : 0uz;
+
+                        if (end - data < static_cast<std::ptrdiff_t>(count_size))
+                            return false;
+
+                        auto const count = is_list(property) ? static_cast<std::size_t>(read(data, property.m_count_type)) : 1uz;
+                        auto const size = get_size(property.m_type);
+
+                        data += count_size;
+
+                        if (static_cast<std::size_t>(end - data) < count * size)
+                            return false;
+
+                        if (property.m_name == "vertex_indices" || property.m_name == "vertex_index") {
+                            polygon.clear();
+
+                            for (auto i = 0uz; i < count; i++)
+                                polygon.push_back(static_cast<uint32_t>(read(data + i * size, property.m_type)));
+
+                            for (auto i = 2uz; i < polygon.size(); i++)
+                                mesh.m_indices.insert(mesh.m_indices.end(), { polygon[0], polygon[i - 1], polygon[i] });
+                        }
+
+                        data += count * size;
+                    }
+            } else {
+                // Skip elements we do not use
+                for (auto e = 0uz; e < element.m_count; e++)
+                    for (auto&& property : element.m_properties) {
+                        auto count = 1uz;
+
+                        if (is_list(property)) {
+                            if (data >= end)
+                                return false;
+
+                            count = static_cast<std::size_t>(read(data, property.m_count_type));
+                            data += get_size(property.m_count_type);
+                        }
+
+                        data += count * get_size(property.m_type);
+                    }
+
+                if (data > end)
+                    return false;
+            }
+        }
+
+        return std::all_of(mesh.m_indices.begin(), mesh.m_indices.end(), [&](auto index) { return index < mesh.get_vertex_count(); });
+    }
+
+    // Loads an OBJ or PLY file depending on its extension
+    bool inline load(std::string const& path, MeshData& mesh, std::size_t threads = 0)
+    {
+        if (path.ends_with(".ply"))
+            return load_ply(path, mesh, threads);
+
+        return load_obj(path, mesh, threads);
+    }
+
+    // Replaces the normals of the mesh with area weighted averages of the normals of the triangles around
+    // every vertex, for smooth shading of meshes stored without them.
+    void inline compute_normals(MeshData& mesh)
+    {
+        auto normals = std::vector<Vec3<double>>(mesh.get_vertex_count(), Vec3<double> { 0. });
+
+        for (auto i = 0uz; i < mesh.m_indices.size(); i += 3) {
+            auto const v0 = mesh.get_vertex(mesh.m_indices[i]);
+
+            // The cross product is twice the area of the triangle in length
+            auto const normal = cross(mesh.get_vertex(mesh.m_indices[i + 1]) - v0, mesh.get_vertex(mesh.m_indices[i + 2]) - v0);
+
+            for (auto j = 0uz; j < 3; j++)
+                normals[mesh.m_indices[i + j]] += normal;
+        }
+
+        mesh.m_nx.clear();
+        mesh.m_ny.clear();
+        mesh.m_nz.clear();
+
+        for (auto&& normal : normals)
+            mesh.add_normal(dot(normal, normal) > 0. ? normalize(normal) : normal);
+    }
+}
+
+}
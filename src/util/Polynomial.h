@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include "Stats.h"
+
+#ifndef RAYTRACER_POLYNOMIAL_EPSILON
+#    define RAYTRACER_POLYNOMIAL_EPSILON 1e-12
+#endif
+
+#ifndef RAYTRACER_POLYNOMIAL_NEWTON_STEPS
+// Newton iterations used to polish each closed-form root against the original polynomial
+#    define RAYTRACER_POLYNOMIAL_NEWTON_STEPS 2
+#endif
+
+namespace Raytracer {
+
+namespace Polynomial {
+    /**
+     * Closed-form solvers for monic polynomials of degree 2 to 4
+     * After: Jochen Schwarze, "Cubic and Quartic Roots", Graphics Gems I.
+     *
+     * Each solver writes the real roots into roots and returns how many were found, roots are unordered and
+     * may repeat. There is no iteration, so the cost of a call is bounded and independent of the input.
+     */
+
+    auto inline is_zero(double x)
+    {
+        return std::abs(x) < RAYTRACER_POLYNOMIAL_EPSILON;
+    }
+
+    // x^2 + b x + c = 0
+    std::size_t inline solve_quadratic(double b, double c, double* roots)
+    {
+        auto const p = b / 2.;
+        auto const discriminant = p * p - c;
+
+        if (is_zero(discriminant)) {
+            roots[0] = -p;
+            return 1;
+        }
+
+        if (discriminant < 0.)
+            return 0;
+
+        // Avoid cancellation between -p and the square root by computing the smaller root from the product
+        auto const q = -(p + std::copysign(std::sqrt(discriminant), p));
+
+        roots[0] = q;
+        roots[1] = q != 0. ? c / q : 0.;
+
+        return 2;
+    }
+
+    // x^3 + a x^2 + b x + c = 0
+    std::size_t inline solve_cubic(double a, double b, double c, double* roots)
+    {
+        // Substitute x = y - a / 3 to eliminate the quadratic term: y^3 + 3 p y + 2 q = 0
+        auto const a2 = a * a;
+        auto const p = (b - a2 / 3.) / 3.;
+        auto const q = (2. / 27. * a * a2 - a * b / 3. + c) / 2.;
+
+        auto const p3 = p * p * p;
+        auto const discriminant = q * q + p3;
+
+        auto count = 0uz;
+
+        if (is_zero(discriminant)) {
+            if (is_zero(q)) {
+                // One triple root
+                roots[count++] = 0.;
+            } else {
+                // One single and one double root
+                auto const u = std::cbrt(-q);
+
+                roots[count++] = 2. * u;
+                roots[count++] = -u;
+            }
+        } else if (discriminant < 0.) {
+            // Three real roots; the first one is the largest
+            auto const phi = std::acos(std::clamp(-q / std::sqrt(-p3), -1., 1.)) / 3.;
+            auto const t = 2. * std::sqrt(-p);
+
+            roots[count++] = t * std::cos(phi);
+            roots[count++] = -t * std::cos(phi + M_PI / 3.);
+            roots[count++] = -t * std::cos(phi - M_PI / 3.);
+        } else {
+            // One real root
+            auto const sqrt_discriminant = std::sqrt(discriminant);
+
+            roots[count++] = std::cbrt(sqrt_discriminant - q) - std::cbrt(sqrt_discriminant + q);
+        }
+
+        for (auto i = 0uz; i < count; i++)
+            roots[i] -= a / 3.;
+
+        return count;
+    }
+
+    // x^4 + a x^3 + b x^2 + c x + d = 0
+    std::size_t inline solve_quartic(double a, double b, double c, double d, double* roots)
+    {
+        // Substitute x = y - a / 4 to eliminate the cubic term: y^4 + p y^2 + q y + r = 0
+        auto const a2 = a * a;
+        auto const p = -3. / 8. * a2 + b;
+        auto const q = a2 * a / 8. - a * b / 2. + c;
+        auto const r = -3. / 256. * a2 * a2 + a2 * b / 16. - a * c / 4. + d;
+
+        auto count = 0uz;
+
+        if (is_zero(r)) {
+            // y (y^3 + p y + q) = 0
+            count = solve_cubic(0., p, q, roots);
+            roots[count++] = 0.;
+        } else {
+            // Take one root of the resolvent cubic and factor into two quadratics
+            double cubic_roots[3];
+            solve_cubic(-p / 2., -r, r * p / 2. - q * q / 8., cubic_roots);
+
+            auto const z = cubic_roots[0];
+
+            auto u = z * z - r;
+            auto v = 2. * z - p;
+
+            if (is_zero(u))
+                u = 0.;
+            else if (u > 0.)
+                u = std::sqrt(u);
+            else
+                return 0;
+
+            if (is_zero(v))
+                v = 0.;
+            else if (v > 0.)
+                v = std::sqrt(v);
+            else
+                return 0;
+
+            count = solve_quadratic(q < 0. ? -v : v, z - u, roots);
+            count += solve_quadratic(q < 0. ? v : -v, z + u, roots + count);
+        }
+
+        auto const evaluate = [&](double x) { return d + x * (c + x * (b + x * (a + x))); };
+        auto const derivative = [&](double x) { return c + x * (2. * b + x * (3. * a + 4. * x)); };
+
+        for (auto i = 0uz; i < count; i++) {
+            auto x = roots[i] - a / 4.;
+            auto residual = std::abs(evaluate(x));
+
+            for (auto step = 0; step < RAYTRACER_POLYNOMIAL_NEWTON_STEPS && residual > 0.; step++) {
+                auto const slope = derivative(x);
+
+                if (slope == 0.)
+                    break;
+
+                RAYTRACER_STATS(Stats::count(Stats::NewtonSteps));
+
+                // Near a double root Newton can overshoot; only keep steps that improve the residual
+                auto const next = x - evaluate(x) / slope;
+                auto const next_residual = std::abs(evaluate(next));
+
+                if (next_residual >= residual)
+                    break;
+
+                x = next;
+                residual = next_residual;
+            }
+
+            roots[i] = x;
+        }
+
+        return count;
+    }
+}
+
+}
@@ -1,18 +1,23 @@
 #pragma once
 
+#include <concepts>
+
 #include "Vec.h"
 
-class Ray {
+template <std::floating_point T>
+class BasicRay {
 private:
-    Vec3<double> m_origin;
-    Vec3<double> m_direction;
+    Vec3<T> m_origin;
+    Vec3<T> m_direction;
 
 public:
-    Ray(auto origin, auto direction)
+    BasicRay(auto origin, auto direction)
         : m_origin(origin)
         , m_direction(direction) {};
 
     auto const& get_origin() const { return m_origin; }
     auto const& get_direction() const { return m_direction; }
-    auto get_point(double time) const { return m_origin + m_direction * time; }
+    auto get_point(T time) const { return m_origin + m_direction * time; }
 };
+
+using Ray = BasicRay<double>;
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#    include <immintrin.h>
+#endif
+
+#include "Ray.h"
+#include "Vec.h"
+
+#ifndef RAYTRACER_PACKET_WIDTH
+// Lanes per packet of doubles, one full vector register for the target; packets of floats have twice as many
+#    if defined(__AVX512F__)
+#        define RAYTRACER_PACKET_WIDTH 8
+#    elif defined(__AVX__)
+#        define RAYTRACER_PACKET_WIDTH 4
+#    else
+#        define RAYTRACER_PACKET_WIDTH 2
+#    endif
+#endif
+
+// GCC vector extensions; arithmetic and comparisons are element-wise and compile to SIMD instructions
+// for the target. Comparisons produce a mask with all bits set in the lanes where they hold, its lanes are
+// integers of the same size as the scalars. Vector types cannot depend on a template parameter, hence the
+// specializations.
+namespace Detail {
+    constexpr std::size_t packet_bytes = RAYTRACER_PACKET_WIDTH * sizeof(double);
+
+    template <std::floating_point T>
+    struct PacketTypes;
+
+    template <>
+    struct PacketTypes<double> {
+        using Integer = int64_t;
+        using Scalars = double __attribute__((vector_size(packet_bytes)));
+        using Mask = int64_t __attribute__((vector_size(packet_bytes)));
+    };
+
+    template <>
+    struct PacketTypes<float> {
+        using Integer = int32_t;
+        using Scalars = float __attribute__((vector_size(packet_bytes)));
+        using Mask = int32_t __attribute__((vector_size(packet_bytes)));
+    };
+}
+
+template <std::floating_point T>
+using PacketOf = typename Detail::PacketTypes<T>::Scalars;
+
+template <std::floating_point T>
+using PacketMaskOf = typename Detail::PacketTypes<T>::Mask;
+
+// Shape and element indices of the lanes of a packet
+template <std::floating_point T>
+using PacketIndexOf = PacketMaskOf<T>;
+
+using PacketDouble = PacketOf<double>;
+using PacketFloat = PacketOf<float>;
+using PacketMask = PacketMaskOf<double>;
+using PacketIndex = PacketIndexOf<double>;
+
+namespace Raytracer {
+
+namespace Packet {
+    template <std::floating_point T>
+    constexpr std::size_t width = Detail::packet_bytes / sizeof(T);
+
+    // Type of the lanes of masks and indices
+    template <std::floating_point T>
+    using Integer = typename Detail::PacketTypes<T>::Integer;
+
+    template <typename Mask>
+    bool inline any(Mask const& mask)
+    {
+        auto result = mask[0];
+
+        for (auto i = 1uz; i < sizeof(Mask) / sizeof(mask[0]); i++)
+            result |= mask[i];
+
+        return result != 0;
+    }
+
+    // Same argument order and NaN behaviour as std::min / std::max
+    template <typename Scalars>
+    Scalars inline min(Scalars const& a, Scalars const& b) { return b < a ? b : a; }
+
+    template <typename Scalars>
+    Scalars inline max(Scalars const& a, Scalars const& b) { return a < b ? b : a; }
+
+    template <typename Scalars>
+    Scalars inline sqrt(Scalars const& a)
+    {
+        // Whole registers at once where the target has the instruction; the loop below stays scalar since
+        // std::sqrt may have to set errno.
+        using Lane = std::remove_cvref_t<decltype(a[0])>;
+
+#if defined(__AVX512F__)
+        if constexpr (sizeof(Scalars) == 64 && std::is_same_v<Lane, double>)
+            return (Scalars)_mm512_sqrt_pd((__m512d)a);
+
+        if constexpr (sizeof(Scalars) == 64 && std::is_same_v<Lane, float>)
+            return (Scalars)_mm512_sqrt_ps((__m512)a);
+#endif
+#if defined(__AVX__)
+        if constexpr (sizeof(Scalars) == 32 && std::is_same_v<Lane, double>)
+            return (Scalars)_mm256_sqrt_pd((__m256d)a);
+
+        if constexpr (sizeof(Scalars) == 32 && std::is_same_v<Lane, float>)
+            return (Scalars)_mm256_sqrt_ps((__m256)a);
+#endif
+#if defined(__SSE2__)
+        if constexpr (sizeof(Scalars) == 16 && std::is_same_v<Lane, double>)
+            return (Scalars)_mm_sqrt_pd((__m128d)a);
+
+        if constexpr (sizeof(Scalars) == 16 && std::is_same_v<Lane, float>)
+            return (Scalars)_mm_sqrt_ps((__m128)a);
+#endif
+
+        auto result = Scalars {};
+
+        for (auto i = 0uz; i < sizeof(Scalars) / sizeof(a[0]); i++)
+            result[i] = std::sqrt(a[i]);
+
+        return result;
+    }
+
+    // Dot product of two structure-of-arrays vectors, summed in the same order as the scalar dot()
+    template <typename Scalars>
+    Scalars inline dot(Scalars const* a, Scalars const* b)
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    template <typename Scalars, std::floating_point T>
+    Scalars inline dot(Scalars const* a, Vec3<T> const& b)
+    {
+        return a[0] * b.x + a[1] * b.y + a[2] * b.z;
+    }
+}
+
+}
+
+// A bundle of rays stored as structure of arrays, one lane per ray.
+template <std::floating_point T>
+class BasicRayPacket {
+private:
+    PacketOf<T> m_origin[3];
+    PacketOf<T> m_direction[3];
+    PacketOf<T> m_inverse_direction[3];
+
+public:
+    BasicRayPacket()
+        : m_origin {}
+        , m_direction {}
+        , m_inverse_direction {} {};
+
+    void set_ray(std::size_t lane, BasicRay<T> const& ray)
+    {
+        for (auto axis = 0uz; axis < 3; axis++) {
+            m_origin[axis][lane] = ray.get_origin()[axis];
+            m_direction[axis][lane] = ray.get_direction()[axis];
+            m_inverse_direction[axis][lane] = T { 1 } / ray.get_direction()[axis];
+        }
+    }
+
+    auto const* get_origin() const { return m_origin; }
+    auto const* get_direction() const { return m_direction; }
+    auto const* get_inverse_direction() const { return m_inverse_direction; }
+
+    BasicRay<T> get_ray(std::size_t lane) const
+    {
+        return BasicRay<T>(
+            Vec3<T> { m_origin[0][lane], m_origin[1][lane], m_origin[2][lane] },
+            Vec3<T> { m_direction[0][lane], m_direction[1][lane], m_direction[2][lane] });
+    }
+};
+
+using RayPacket = BasicRayPacket<double>;
@@ -1,11 +1,39 @@
 #pragma once
 
+#include <concepts>
+#include <cstdint>
+
 #include "Material.h"
+#include "RayPacket.h"
 #include "Vec.h"
 
-struct Record {
-    Material m_material;
-    double m_time;
-    Vec3<double> m_point;
-    Vec3<double> m_normal;
+// Result of a closest-hit query; only what is needed to keep searching and to find the shape again.
+template <std::floating_point T>
+struct BasicHit {
+    static constexpr uint32_t miss = UINT32_MAX;
+
+    T m_time;
+    uint32_t m_shape;   // Index into the scene's shapes
+    uint32_t m_element; // Element of the shape, see BasicShape::find_intersection()
+};
+
+// Closest hits of a packet of rays, one lane per ray; the indices are stored in integer lanes as wide as T.
+template <std::floating_point T>
+struct BasicPacketHit {
+    PacketOf<T> m_time;
+    PacketIndexOf<T> m_shape;
+    PacketIndexOf<T> m_element;
 };
+
+// Shading data, resolved once for the closest hit.
+template <std::floating_point T>
+struct BasicRecord {
+    BasicMaterial<T> const& m_material;
+    T m_time;
+    Vec3<T> m_point;
+    Vec3<T> m_normal;
+};
+
+using Hit = BasicHit<double>;
+using PacketHit = BasicPacketHit<double>;
+using Record = BasicRecord<double>;
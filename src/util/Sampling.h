@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+
+enum class SamplingMode {
+    Center,   // One ray through the center of every pixel
+    Grid,     // Regular grid of m_grid_size x m_grid_size rays per pixel
+    Adaptive, // Rays at pixel corners, shared between neighbours, subdivided where they disagree
+};
+
+struct Sampling {
+    SamplingMode m_mode;
+
+    std::size_t m_grid_size = 2;
+
+    // Adaptive: a pixel is subdivided into quadrants while its corner samples hit different shapes or any
+    // color channel differs by more than m_threshold, up to m_max_depth times (at most (2^d + 1)^2 rays).
+    std::size_t m_max_depth = 2;
+    double m_threshold = .1;
+};
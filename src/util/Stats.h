@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "Vec.h"
+
+/**
+ * Render instrumentation, enabled by defining RAYTRACER_ENABLE_STATS
+ *
+ * Rays of each kind, bounding box and primitive tests, torus solver work, shadow occluder cache lookups and the
+ * deepest recursion reached are counted into counters owned by the calling thread, so counting takes no locks or
+ * atomics. Camera::render() collects them per tile and per worker along with the wall-clock time of every tile,
+ * and charges the work of every pixel to a cost buffer that heatmap() turns into a false colour image.
+ *
+ * Without RAYTRACER_ENABLE_STATS the RAYTRACER_STATS() statements in the renderer expand to nothing.
+ */
+
+#ifdef RAYTRACER_ENABLE_STATS
+#    define RAYTRACER_STATS(...) __VA_ARGS__
+#else
+#    define RAYTRACER_STATS(...)
+#endif
+
+namespace Raytracer {
+
+namespace Stats {
+    enum Counter : std::size_t {
+        PrimaryRays,
+        ShadowRays,
+        ReflectionRays,
+        BoxTests,
+        SphereTests,
+        PlaneTests,
+        TriangleTests,
+        MeshTriangleTests,
+        InstanceTests,
+        TorusTests,
+        QuarticsSolved,
+        NewtonSteps,
+        OccluderCacheHits,
+        OccluderCacheMisses,
+        CounterCount,
+    };
+
+    constexpr char const* counter_names[CounterCount] = {
+        "primary rays",
+        "shadow rays",
+        "reflection rays",
+        "bounding box tests",
+        "sphere tests",
+        "plane tests",
+        "triangle tests",
+        "mesh triangle tests",
+        "instance tests",
+        "torus tests",
+        "quartics solved",
+        "newton steps",
+        "occluder hits",
+        "occluder misses",
+    };
+
+    struct Counters {
+        std::array<uint64_t, CounterCount> m_values {};
+        int m_max_depth = 0;
+
+        // Intersection tests of any kind, the cost shown by the heatmap
+        uint64_t work() const
+        {
+            auto result = 0ull;
+
+            for (auto counter = BoxTests; counter <= TorusTests; counter = static_cast<Counter>(counter + 1))
+                result += m_values[counter];
+
+            return result;
+        }
+
+        void merge(Counters const& other)
+        {
+            for (auto i = 0uz; i < CounterCount; i++)
+                m_values[i] += other.m_values[i];
+
+            m_max_depth = std::max(m_max_depth, other.m_max_depth);
+        }
+
+        Counters operator-(Counters const& other) const
+        {
+            auto result = *this;
+
+            for (auto i = 0uz; i < CounterCount; i++)
+                result.m_values[i] -= other.m_values[i];
+
+            return result;
+        }
+    };
+
+    // Counters of the calling thread
+    Counters inline& local()
+    {
+        thread_local auto counters = Counters {};
+
+        return counters;
+    }
+
+    void inline count(Counter counter, uint64_t amount = 1)
+    {
+        local().m_values[counter] += amount;
+    }
+
+    // Counts a ray traced at the given recursion depth
+    void inline reach_depth(int depth)
+    {
+        auto& counters = local();
+        counters.m_max_depth = std::max(counters.m_max_depth, depth);
+    }
+
+    // Number of active lanes of a packet mask
+    template <typename Mask>
+    uint64_t inline lanes(Mask const& mask)
+    {
+        auto result = 0ull;
+
+        for (auto i = 0uz; i < sizeof(Mask) / sizeof(mask[0]); i++)
+            result += mask[i] != 0;
+
+        return result;
+    }
+
+    // Work counted on this thread since the previous call
+    uint64_t inline take_work()
+    {
+        thread_local auto taken = 0ull;
+
+        auto const work = local().work();
+        auto const result = work - taken;
+
+        taken = work;
+
+        return result;
+    }
+
+    struct Tile {
+        std::size_t m_u;
+        std::size_t m_v;
+        double m_seconds;
+        Counters m_counters;
+    };
+
+    // Statistics of the last frame rendered by a camera
+    struct Frame {
+        std::size_t m_width = 0;
+        std::size_t m_height = 0;
+        double m_seconds = 0;
+
+        // Work per pixel, stored top row first like the image
+        std::vector<uint64_t> m_cost;
+        std::vector<Tile> m_tiles;
+        std::vector<Counters> m_workers;
+        Counters m_total;
+    };
+
+    /**
+     * The cost buffer of a frame in false colour, from black through blue, green and yellow to white
+     *
+     * Costs are scaled logarithmically from the cheapest to the most expensive pixel, so cheap background and
+     * expensive outliers both stay visible.
+     */
+    std::vector<Vec3<uint8_t>> inline heatmap(Frame const& frame)
+    {
+        auto const ramp = std::array<Vec3<double>, 5> {
+            Vec3<double> { 0., 0., 0. },
+            Vec3<double> { 0., 0., 1. },
+            Vec3<double> { 0., 1., 0. },
+            Vec3<double> { 1., 1., 0. },
+            Vec3<double> { 1., 1., 1. },
+        };
+
+        if (frame.m_cost.empty())
+            return {};
+
+        auto const [lowest, highest] = std::minmax_element(frame.m_cost.begin(), frame.m_cost.end());
+        auto const offset = std::log1p(static_cast<double>(*lowest));
+        auto const scale = std::log1p(static_cast<double>(*highest)) - offset;
+
+        auto pixels = std::vector<Vec3<uint8_t>>(frame.m_cost.size(), Vec3<uint8_t> { 0 });
+
+        for (auto i = 0uz; i < pixels.size(); i++) {
+            auto const t = scale > 0 ? (std::log1p(static_cast<double>(frame.m_cost[i])) - offset) / scale * (ramp.size() - 1) : 0.;
+            auto const segment = std::min(static_cast<std::size_t>(t), ramp.size() - 2);
+            auto const color = ramp[segment] + (t - segment) * (ramp[segment + 1] - ramp[segment]);
+
+            color.for_each_const([&](auto const& a, auto idx) {
+                pixels[i][idx] = static_cast<uint8_t>(std::clamp(255. * a, 0., 255.));
+            });
+        }
+
+        return pixels;
+    }
+
+    // Totals, per worker shares and the slowest tiles of a frame in plain text
+    void inline write_report(std::FILE* file, Frame const& frame, std::size_t slowest_tiles = 5)
+    {
+        auto const& total = frame.m_total;
+        auto const primary = std::max<uint64_t>(1, total.m_values[PrimaryRays]);
+
+        std::fprintf(file, "%zu x %zu pixels in %.1f ms, %zu tiles, %zu workers\n", frame.m_width, frame.m_height, 1e3 * frame.m_seconds, frame.m_tiles.size(), frame.m_workers.size());
+        std::fprintf(file, "%-20s %16s %14s\n", "", "total", "per primary");
+
+        for (auto i = 0uz; i < CounterCount; i++)
+            std::fprintf(file, "%-20s %16llu %14.2f\n", counter_names[i], static_cast<unsigned long long>(total.m_values[i]), static_cast<double>(total.m_values[i]) / primary);
+
+        std::fprintf(file, "%-20s %16d\n", "max depth", total.m_max_depth);
+
+        // Shadow rays blocked by the occluder that blocked the previous one towards their light
+        if (auto const tested = total.m_values[OccluderCacheHits] + total.m_values[OccluderCacheMisses])
+            std::fprintf(file, "occluder cache: %.1f %% of %llu lookups hit\n", 100. * total.m_values[OccluderCacheHits] / tested, static_cast<unsigned long long>(tested));
+
+        for (auto i = 0uz; i < frame.m_workers.size(); i++)
+            std::fprintf(file, "worker %-3zu %25.1f %% of the work\n", i, 100. * frame.m_workers[i].work() / std::max<uint64_t>(1, total.work()));
+
+        if (frame.m_tiles.empty())
+            return;
+
+        auto tiles = frame.m_tiles;
+        std::sort(tiles.begin(), tiles.end(), [](auto const& a, auto const& b) { return a.m_seconds > b.m_seconds; });
+
+        std::fprintf(file, "tile time: %.2f ms median, %.2f ms max\n", 1e3 * tiles[tiles.size() / 2].m_seconds, 1e3 * tiles.front().m_seconds);
+
+        for (auto i = 0uz; i < std::min(slowest_tiles, tiles.size()); i++)
+            std::fprintf(
+                file,
+                "  tile (%zu, %zu) %8.2f ms %12llu tests %10llu rays\n",
+                tiles[i].m_u,
+                tiles[i].m_v,
+                1e3 * tiles[i].m_seconds,
+                static_cast<unsigned long long>(tiles[i].m_counters.work()),
+                static_cast<unsigned long long>(tiles[i].m_counters.m_values[PrimaryRays] + tiles[i].m_counters.m_values[ShadowRays] + tiles[i].m_counters.m_values[ReflectionRays]));
+    }
+}
+
+}
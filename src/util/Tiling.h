@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+enum class TileOrder {
+    Columns, // Column by column from the lower left, bottom to top
+    Morton,  // Z-order curve: tiles next in line are close on screen, in 2 x 2, 4 x 4, ... blocks
+    Hilbert, // Hilbert curve: like Morton, but every tile is next to the one before
+    Spiral,  // Rings around the center of the image outwards, so that it appears first
+};
+
+struct Tiling {
+    // Width and height of the square chunks the image is split into; any size from 1 up, clipped at the
+    // right and top edges of the image.
+    std::size_t m_size = 64;
+
+    TileOrder m_order = TileOrder::Columns;
+};
+
+namespace Raytracer {
+
+namespace Tiles {
+    namespace Detail {
+        // Bits of u in the even positions, bits of v in the odd ones
+        inline uint64_t interleave(uint32_t u, uint32_t v)
+        {
+            auto spread = [](uint64_t x) {
+                x = (x | (x << 16)) & 0x0000ffff0000ffffull;
+                x = (x | (x << 8)) & 0x00ff00ff00ff00ffull;
+                x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0full;
+                x = (x | (x << 2)) & 0x3333333333333333ull;
+                x = (x | (x << 1)) & 0x5555555555555555ull;
+
+                return x;
+            };
+
+            return spread(u) | (spread(v) << 1);
+        }
+
+        // Distance of (u, v) along the Hilbert curve through an n x n grid, n a power of two
+        inline uint64_t hilbert(uint64_t n, uint64_t u, uint64_t v)
+        {
+            auto distance = uint64_t {};
+
+            for (auto s = n / 2; s > 0; s /= 2) {
+                auto const ru = (u & s) ? 1ull : 0ull;
+                auto const rv = (v & s) ? 1ull : 0ull;
+
+                distance += s * s * ((3 * ru) ^ rv);
+
+                // Rotates the quadrant so the curve inside it starts where the one of the parent left off
+                if (!rv) {
+                    if (ru) {
+                        u = s - 1 - (u & (s - 1));
+                        v = s - 1 - (v & (s - 1));
+                    }
+
+                    std::swap(u, v);
+                }
+            }
+
+            return distance;
+        }
+    }
+
+    /**
+     * The tiles (u, v) of a columns x rows grid in the order they are rendered
+     *
+     * Workers take tiles from the front one at a time, so the few rendered at the same time are neighbours
+     * in this order. With Morton and Hilbert order they are also neighbours on screen, and their rays tend to
+     * go through the same BVH nodes and shapes, which then stay in the caches the workers share. Morton and
+     * Hilbert order are those of the smallest power of two grid around the tiles, skipping the ones outside.
+     */
+    inline std::vector<std::pair<std::size_t, std::size_t>> order(std::size_t columns, std::size_t rows, TileOrder order)
+    {
+        auto tiles = std::vector<std::pair<std::size_t, std::size_t>> {};
+        tiles.reserve(columns * rows);
+
+        for (auto u = 0uz; u < columns; u++)
+            for (auto v = 0uz; v < rows; v++)
+                tiles.push_back(std::make_pair(u, v));
+
+        auto sort_by = [&](auto&& key) {
+            auto keys = std::vector<std::pair<decltype(key(0uz, 0uz)), std::size_t>> {};
+            keys.reserve(tiles.size());
+
+            for (auto k = 0uz; k < tiles.size(); k++)
+                keys.push_back({ key(tiles[k].first, tiles[k].second), k });
+
+            std::sort(keys.begin(), keys.end());
+
+            auto sorted = std::vector<std::pair<std::size_t, std::size_t>> {};
+            sorted.reserve(tiles.size());
+
+            for (auto&& [_, k] : keys)
+                sorted.push_back(tiles[k]);
+
+            tiles = std::move(sorted);
+        };
+
+        switch (order) {
+        case TileOrder::Columns:
+            break;
+        case TileOrder::Morton:
+            sort_by([](std::size_t u, std::size_t v) { return Detail::interleave(static_cast<uint32_t>(u), static_cast<uint32_t>(v)); });
+            break;
+        case TileOrder::Hilbert: {
+            auto const n = std::bit_ceil(std::max<std::size_t>({ columns, rows, 1 }));
+
+            sort_by([&](std::size_t u, std::size_t v) { return Detail::hilbert(n, u, v); });
+            break;
+        }
+        case TileOrder::Spiral:
+            // Square rings of tiles around the center, each one counterclockwise from the left
+            sort_by([&](std::size_t u, std::size_t v) {
+                auto const x = u + .5 - columns / 2.;
+                auto const y = v + .5 - rows / 2.;
+
+                return std::make_pair(std::floor(std::max(std::abs(x), std::abs(y))), std::atan2(y, x));
+            });
+            break;
+        }
+
+        return tiles;
+    }
+}
+
+}
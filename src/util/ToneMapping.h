@@ -0,0 +1,82 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "Vec.h"
+
+enum class ToneOperator {
+    Clamp,    // Colors above 1 are cut off, like the 8 bit framebuffer always did
+    Reinhard, // c / (1 + c), compressing highlights instead of clipping them
+};
+
+struct ToneMapping {
+    ToneOperator m_operator = ToneOperator::Clamp;
+
+    // Radiance is multiplied by m_exposure before the operator; the result is raised to 1 / m_gamma.
+    float m_exposure = 1;
+    float m_gamma = 1;
+};
+
+namespace Raytracer {
+
+namespace ToneMap {
+    namespace Detail {
+        // One branch free loop per combination of settings, so that the compiler vectorizes each of them
+        template <ToneOperator Operator, bool Gamma>
+        void apply(std::span<Vec3<float> const> radiance, float scale, float inverse_gamma, std::span<Vec3<uint8_t>> pixels)
+        {
+            for (auto k = 0uz; k < radiance.size(); k++) {
+                auto const& color = radiance[k];
+                float channels[3] = { color.x, color.y, color.z };
+
+                for (auto& c : channels) {
+                    c *= scale;
+
+                    if constexpr (Operator == ToneOperator::Reinhard)
+                        c = c / (1.f + c);
+
+                    c = std::clamp(c, 0.f, 1.f);
+
+                    if constexpr (Gamma)
+                        c = std::pow(c, inverse_gamma);
+                }
+
+                pixels[k] = Vec3<uint8_t> {
+                    static_cast<uint8_t>(255.f * channels[0]),
+                    static_cast<uint8_t>(255.f * channels[1]),
+                    static_cast<uint8_t>(255.f * channels[2]),
+                };
+            }
+        }
+    }
+
+    /**
+     * Maps linear radiance, scaled by scale (e.g. one over the samples summed in it), to 8 bit pixels
+     *
+     * radiance and pixels are the same pixels and have the same size; they may be any part of an image.
+     */
+    void inline apply(std::span<Vec3<float> const> radiance, float scale, ToneMapping const& tone_mapping, std::span<Vec3<uint8_t>> pixels)
+    {
+        scale *= tone_mapping.m_exposure;
+
+        auto const gamma = tone_mapping.m_gamma != 1;
+        auto const inverse_gamma = 1 / tone_mapping.m_gamma;
+
+        switch (tone_mapping.m_operator) {
+        case ToneOperator::Clamp:
+            gamma ? Detail::apply<ToneOperator::Clamp, true>(radiance, scale, inverse_gamma, pixels)
+                  : Detail::apply<ToneOperator::Clamp, false>(radiance, scale, inverse_gamma, pixels);
+            break;
+        case ToneOperator::Reinhard:
+            gamma ? Detail::apply<ToneOperator::Reinhard, true>(radiance, scale, inverse_gamma, pixels)
+                  : Detail::apply<ToneOperator::Reinhard, false>(radiance, scale, inverse_gamma, pixels);
+            break;
+        }
+    }
+}
+
+}
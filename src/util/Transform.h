@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cmath>
+#include <concepts>
+
+#include "BoundingBox.h"
+#include "Vec.h"
+
+/**
+ * Affine transform: a point p maps to (dot(m_x, p), dot(m_y, p), dot(m_z, p)) + m_translation
+ *
+ * m_x, m_y and m_z are the rows of the linear part. The default is the identity.
+ */
+template <std::floating_point T>
+struct BasicTransform {
+    Vec3<T> m_x = { 1, 0, 0 };
+    Vec3<T> m_y = { 0, 1, 0 };
+    Vec3<T> m_z = { 0, 0, 1 };
+    Vec3<T> m_translation = { 0, 0, 0 };
+
+    static BasicTransform translation(Vec3<T> const& offset)
+    {
+        return { .m_translation = offset };
+    }
+
+    static BasicTransform scaling(Vec3<T> const& factors)
+    {
+        return { { factors.x, 0, 0 }, { 0, factors.y, 0 }, { 0, 0, factors.z }, { 0, 0, 0 } };
+    }
+
+    // Counterclockwise, looking down the axis towards the origin
+    static BasicTransform rotation(Vec3<T> const& axis, T degrees)
+    {
+        auto const unit = normalize(axis);
+        auto const x = unit.x;
+        auto const y = unit.y;
+        auto const z = unit.z;
+
+        auto const radians = static_cast<T>(degrees / 180 * M_PI);
+        auto const c = std::cos(radians);
+        auto const s = std::sin(radians);
+        auto const t = 1 - c;
+
+        return {
+            { c + x * x * t, x * y * t - z * s, x * z * t + y * s },
+            { y * x * t + z * s, c + y * y * t, y * z * t - x * s },
+            { z * x * t - y * s, z * y * t + x * s, c + z * z * t },
+            { 0, 0, 0 },
+        };
+    }
+
+    Vec3<T> apply_vector(Vec3<T> const& vector) const
+    {
+        return { dot(m_x, vector), dot(m_y, vector), dot(m_z, vector) };
+    }
+
+    Vec3<T> apply_point(Vec3<T> const& point) const
+    {
+        return apply_vector(point) + m_translation;
+    }
+
+    // The linear part transposed; applied by the inverse of a transform, it maps normals through the transform.
+    Vec3<T> apply_transposed(Vec3<T> const& vector) const
+    {
+        return vector.x * m_x + vector.y * m_y + vector.z * m_z;
+    }
+
+    // Box around the transformed corners of box
+    BasicBoundingBox<T> apply(BasicBoundingBox<T> const& box) const
+    {
+        auto result = BasicBoundingBox<T>::empty();
+
+        for (auto corner = 0u; corner < 8; corner++)
+            result.merge(apply_point({
+                (corner & 1 ? box.get_max() : box.get_min()).x,
+                (corner & 2 ? box.get_max() : box.get_min()).y,
+                (corner & 4 ? box.get_max() : box.get_min()).z,
+            }));
+
+        return result;
+    }
+
+    // The transform applying other first, then this one
+    BasicTransform operator*(BasicTransform const& other) const
+    {
+        return {
+            other.apply_transposed(m_x),
+            other.apply_transposed(m_y),
+            other.apply_transposed(m_z),
+            apply_point(other.m_translation),
+        };
+    }
+
+    // Only defined for transforms that do not flatten space, i.e. that scale by anything but zero
+    BasicTransform inverse() const
+    {
+        auto const c0 = cross(m_y, m_z);
+        auto const c1 = cross(m_z, m_x);
+        auto const c2 = cross(m_x, m_y);
+        auto const inverse_determinant = 1 / dot(m_x, c0);
+
+        auto result = BasicTransform {
+            inverse_determinant * Vec3<T> { c0.x, c1.x, c2.x },
+            inverse_determinant * Vec3<T> { c0.y, c1.y, c2.y },
+            inverse_determinant * Vec3<T> { c0.z, c1.z, c2.z },
+            { 0, 0, 0 },
+        };
+
+        result.m_translation = T { -1 } * result.apply_vector(m_translation);
+
+        return result;
+    }
+};
+
+using Transform = BasicTransform<double>;
@@ -1,76 +1,129 @@
 #pragma once
 
+#include <array>
+#include <cassert>
 #include <cmath>
 #include <concepts>
 #include <cstddef>
+#include <cstdint>
 
 #include <ostream>
+#include <type_traits>
 #include <utility>
 
 #include "Concepts.h"
 
+namespace Detail {
+    // Floating point Vec3 carries a fourth padding lane so that it fills (and is aligned to) a full
+    // 16 byte (float) or 32 byte (double) register; integral vectors such as pixels stay packed.
+    template <std::size_t N, typename T>
+    constexpr std::size_t vec_lanes = (N == 3 && std::is_floating_point_v<T>) ? 4 : N;
+
+    template <std::size_t N, typename T>
+    constexpr std::size_t vec_alignment = std::is_floating_point_v<T> && vec_lanes<N, T> == 4 ? 4 * sizeof(T) : alignof(T);
+
+    template <std::size_t Lanes, typename T>
+    struct VecStorage;
+
+    template <typename T>
+    struct VecStorage<2, T> {
+        T x {};
+        T y {};
+    };
+
+    template <typename T>
+    struct VecStorage<3, T> {
+        T x {};
+        T y {};
+        T z {};
+    };
+
+    template <typename T>
+    struct VecStorage<4, T> {
+        T x {};
+        T y {};
+        T z {};
+        T w {};
+    };
+}
+
 template <std::size_t N, Numeric T>
-class Vec {
-public:
-    T x;
-    T y;
-    T z;
-    T w;
+class alignas(Detail::vec_alignment<N, T>) Vec : public Detail::VecStorage<Detail::vec_lanes<N, T>, T> {
+    static_assert(N >= 2 && N <= 4);
 
-    T& r;
-    T& g;
-    T& b;
-    T& a;
+    static constexpr std::size_t Lanes = Detail::vec_lanes<N, T>;
 
-    T* refs[4] = { &x, &y, &z, &w };
+    // Applies func to every lane, including the padding lane. Used for element-wise arithmetic so
+    // the compiler sees a full register-width operation; the padding lane holds no meaningful value.
+    template <typename F>
+    constexpr Vec& for_each_lane(F&& func)
+    {
+        [&]<std::size_t... I>(std::index_sequence<I...>)
+        {
+            (func((*this)[I], I), ...);
+        }
+        (std::make_index_sequence<Lanes> {});
 
-    Vec(T a, T b, T c, T d)
-        : x(a)
-        , y(b)
-        , z(c)
-        , w(d)
-        , r(x)
-        , g(y)
-        , b(z)
-        , a(w) {};
+        return *this;
+    }
 
-    Vec()
-        : Vec(0, 0, 0, 0) {};
+public:
+    constexpr Vec() = default;
 
-    Vec(T a, T b, T c)
-        : Vec(a, b, c, 0) {};
+    constexpr Vec(T a, T b, T c, T d) requires(N == 4)
+        : Detail::VecStorage<Lanes, T> { a, b, c, d } {};
 
-    Vec(T a, T b)
-        : Vec(a, b, 0, 0) {};
+    constexpr Vec(T a, T b, T c) requires(N == 3)
+        : Vec(a, b, c, T {}, std::make_index_sequence<Lanes> {}) {};
 
-    Vec(T a)
-        : Vec(a, a, a, a) {};
+    constexpr Vec(T a, T b) requires(N == 2)
+        : Detail::VecStorage<Lanes, T> { a, b } {};
 
-    Vec(Vec const& rhs)
-        : Vec(rhs.x, rhs.y, rhs.z, rhs.w) {};
+    constexpr Vec(T a)
+        : Vec(a, a, a, a, std::make_index_sequence<Lanes> {}) {};
 
-    auto inline& at(auto idx) const
+    // Element-wise conversion from another scalar type, e.g. between single and double precision
+    template <Numeric U>
+    constexpr explicit Vec(Vec<N, U> const& other) requires(!std::is_same_v<T, U>)
     {
-        if (idx >= N)
-            throw "Index exceeds vector contents";
-
-        return *refs[idx];
+        for_each([&](T& a, auto idx) { a = static_cast<T>(other[idx]); });
     }
-    auto inline& operator[](auto idx)
+
+private:
+    template <std::size_t... I>
+    constexpr Vec(T a, T b, T c, T d, std::index_sequence<I...>)
+        : Detail::VecStorage<Lanes, T> { std::array<T, 4> { a, b, c, d }[I]... } {};
+
+public:
+    constexpr T& operator[](std::size_t idx)
     {
-        return at(idx);
+        return const_cast<T&>(std::as_const(*this)[idx]);
     }
-    auto inline const& operator[](auto idx) const
+
+    constexpr T const& operator[](std::size_t idx) const
     {
-        return std::as_const(at(idx));
+        assert(idx < Lanes);
+
+        if constexpr (Lanes > 3)
+            if (idx == 3)
+                return this->w;
+
+        if constexpr (Lanes > 2)
+            if (idx == 2)
+                return this->z;
+
+        return idx == 1 ? this->y : this->x;
     }
 
+    constexpr T& at(std::size_t idx) { return (*this)[idx]; }
+    constexpr T const& at(std::size_t idx) const { return (*this)[idx]; }
+
     template <typename F>
-    auto inline constexpr for_each(F&& func)
+    constexpr Vec& for_each(F&& func)
     {
         [&]<std::size_t... I>(std::index_sequence<I...>)
         {
-            (func(at(I), I), ...);
+            (func((*this)[I], I), ...);
         }
         (std::make_index_sequence<N> {});
 
@@ -78,28 +131,18 @@ public:
     }
 
     template <typename F>
-    auto inline constexpr for_each_const(F&& func) const
+    constexpr void for_each_const(F&& func) const
     {
         [&]<std::size_t... I>(std::index_sequence<I...>)
         {
-            (func(std::as_const(at(I)), I), ...);
+            (func((*this)[I], I), ...);
         }
         (std::make_index_sequence<N> {});
     }
 
-    Vec<N, T>& operator=(Vec<N, T> const& rhs)
+    constexpr Vec& operator*=(auto const& rhs)
     {
-        x = rhs.x;
-        y = rhs.y;
-        z = rhs.z;
-        w = rhs.w;
-
-        return *this;
-    }
-
-    auto inline operator*=(auto const& rhs)
-    {
-        return for_each([&rhs](T& a, auto idx) {
+        return for_each_lane([&rhs](T& a, auto idx) {
             if constexpr (is_same_cv<decltype(rhs), Vec<N, T>>::value)
                 a *= rhs[idx];
             else
@@ -107,20 +150,20 @@ public:
         });
     }
 
-    friend auto inline operator*(Vec<N, T> const& lhs, auto const& rhs)
+    friend constexpr auto operator*(Vec<N, T> const& lhs, auto const& rhs)
     {
         return Vec<N, T> { lhs } *= rhs;
     }
 
     template <Numeric Scalar>
-    friend auto inline operator*(Scalar const& lhs, Vec<N, T> const& rhs)
+    friend constexpr auto operator*(Scalar const& lhs, Vec<N, T> const& rhs)
     {
         return rhs * lhs;
     }
 
-    auto inline operator/=(auto const& rhs)
+    constexpr Vec& operator/=(auto const& rhs)
     {
-        return for_each([&rhs](T& a, auto idx) {
+        return for_each_lane([&rhs](T& a, auto idx) {
             if constexpr (is_same_cv<decltype(rhs), Vec<N, T>>::value)
                 a /= rhs[idx];
             else
@@ -128,38 +171,38 @@ public:
         });
     }
 
-    friend auto inline operator/(Vec<N, T> const& lhs, auto const& rhs)
+    friend constexpr auto operator/(Vec<N, T> const& lhs, auto const& rhs)
     {
         return Vec<N, T> { lhs } /= rhs;
     }
 
     template <Numeric Scalar>
-    friend auto inline operator/(Scalar const& lhs, Vec<N, T> const& rhs)
+    friend constexpr auto operator/(Scalar const& lhs, Vec<N, T> const& rhs)
     {
         return Vec<N, T> { static_cast<T>(lhs) } /= rhs;
     }
 
-    auto inline operator+=(Vec<N, T> const& rhs)
+    constexpr Vec& operator+=(Vec<N, T> const& rhs)
     {
-        return for_each([&rhs](T& a, auto idx) { a += rhs[idx]; });
+        return for_each_lane([&rhs](T& a, auto idx) { a += rhs[idx]; });
     }
 
-    friend auto inline operator+(Vec<N, T> const& lhs, Vec<N, T> const& rhs)
+    friend constexpr auto operator+(Vec<N, T> const& lhs, Vec<N, T> const& rhs)
     {
         return Vec<N, T> { lhs } += rhs;
     }
 
-    auto inline operator-=(Vec<N, T> const& rhs)
+    constexpr Vec& operator-=(Vec<N, T> const& rhs)
     {
-        return for_each([&rhs](T& a, auto idx) { a -= rhs[idx]; });
+        return for_each_lane([&rhs](T& a, auto idx) { a -= rhs[idx]; });
     }
 
-    friend auto inline operator-(Vec<N, T> const& lhs, Vec<N, T> const& rhs)
+    friend constexpr auto operator-(Vec<N, T> const& lhs, Vec<N, T> const& rhs)
     {
         return Vec<N, T> { lhs } -= rhs;
     }
 
-    __attribute__((flatten)) friend T inline dot(Vec<N, T> const& a, Vec<N, T> const& b)
+    __attribute__((flatten)) friend constexpr T dot(Vec<N, T> const& a, Vec<N, T> const& b)
     {
         auto sum = T {};
 
@@ -169,22 +212,25 @@ public:
     }
 
     template <typename U>
-    U inline magnitude() const
+    constexpr U magnitude() const
     {
         return static_cast<U>(std::sqrt(dot(*this, *this)));
     }
 
-    T inline magnitude() const
+    constexpr T magnitude() const
     {
         return magnitude<T>();
     }
 
-    auto inline normalize()
+    constexpr Vec& normalize()
     {
-        return *this /= magnitude<double>();
+        if constexpr (std::is_floating_point_v<T>)
+            return *this /= magnitude();
+        else
+            return *this /= magnitude<double>();
     }
 
-    friend auto inline normalize(Vec<N, T> const& vec)
+    friend constexpr auto normalize(Vec<N, T> const& vec)
     {
         return Vec<N, T> { vec }.normalize();
     }
@@ -207,7 +253,7 @@ public:
 };
 
 template <typename T>
-__attribute__((flatten)) Vec<3, T> inline cross(Vec<3, T> a, Vec<3, T> b)
+__attribute__((flatten)) constexpr Vec<3, T> cross(Vec<3, T> const& a, Vec<3, T> const& b)
 {
     return { a.y * b.z - a.z * b.y,
              a.z * b.x - a.x * b.z,
@@ -222,3 +268,9 @@ using Vec3 = Vec<3, T>;
 
 template <Numeric T>
 using Vec4 = Vec<4, T>;
+
+static_assert(std::is_trivially_copyable_v<Vec3<double>> && std::is_standard_layout_v<Vec3<double>>);
+static_assert(sizeof(Vec3<double>) == 32 && alignof(Vec3<double>) == 32);
+static_assert(sizeof(Vec4<double>) == 32 && alignof(Vec4<double>) == 32);
+static_assert(sizeof(Vec3<float>) == 16 && alignof(Vec3<float>) == 16);
+static_assert(sizeof(Vec3<uint8_t>) == 3);